@@ -0,0 +1,296 @@
+#include "BatchValidator.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+#include "CurveComparer.h"
+#include "Json.h"
+#include "ProbeCurveLoader.h"
+#include "ProbeRecording.h"
+
+// quote a csv field only when it needs it
+static QString csvField( const QString& value )
+{
+    if( !value.contains( ';' ) && !value.contains( '"' ) && !value.contains( '\n' ) )
+        return value;
+
+    QString quoted = value;
+    quoted.replace( "\"", "\"\"" );
+    return "\"" + quoted + "\"";
+}
+
+//  BatchWorker
+/********************************************************************************/
+
+BatchWorker::BatchWorker( BatchValidator* validator ) : validator( validator )
+{
+    filesCount = 0;
+    failedFilesCount = 0;
+    pointsCount = 0;
+}
+
+void BatchWorker::addFile( int file )
+{
+    QMutexLocker locker( &queueMutex );
+    queue.append( file );
+}
+
+// the owner takes its files in order from the front of its queue...
+bool BatchWorker::popFile( int& file )
+{
+    QMutexLocker locker( &queueMutex );
+    if( queue.isEmpty() )
+        return false;
+
+    file = queue.takeFirst();
+    return true;
+}
+
+// ...and the other workers steal from the back, so they rarely want the same file
+bool BatchWorker::stealFile( int& file )
+{
+    QMutexLocker locker( &queueMutex );
+    if( queue.isEmpty() )
+        return false;
+
+    file = queue.takeLast();
+    return true;
+}
+
+void BatchWorker::run()
+{
+    // reused from one file to the other
+    Curve curve;
+    ValidationResult result;
+    int file;
+
+    // no file is ever added once the workers are started, so when nothing can be stolen, everything is done
+    while( popFile( file ) || validator->stealFile( this, file ) )
+        validator->validateFile( file, curve, result, this );
+}
+
+int BatchWorker::getFilesCount() const
+{
+    return filesCount;
+}
+
+int BatchWorker::getFailedFilesCount() const
+{
+    return failedFilesCount;
+}
+
+qint64 BatchWorker::getPointsCount() const
+{
+    return pointsCount;
+}
+
+//  BatchValidator
+/********************************************************************************/
+
+// mannequinIds are the mannequins each file is validated against, they must all be in the registry
+BatchValidator::BatchValidator( const MannequinRegistry* mannequins, const QStringList& mannequinIds ) :
+    mannequins( mannequins ), mannequinIds( mannequinIds )
+{
+    output = 0;
+    format = Csv;
+    failFast = false;
+    filesCount = 0;
+    failedFilesCount = 0;
+    pointsCount = 0;
+    elapsedNsecs = 0;
+}
+
+BatchValidator::~BatchValidator()
+{
+    qDeleteAll( workers );
+}
+
+// Stop the validations at the first invalid point, for a pass/fail run: the counts of the invalid curves are then partial
+void BatchValidator::setFailFast( bool enabled )
+{
+    failFast = enabled;
+}
+
+// Validate all the files and wait until it's done, the results are written to output in the order they are found
+void BatchValidator::run( const QStringList& files, int threadsCount, QTextStream* output, Format format )
+{
+    this->files = files;
+    this->output = output;
+    this->format = format;
+
+    if( threadsCount < 1 )
+        threadsCount = 1;
+
+    qDeleteAll( workers );
+    workers.clear();
+    for( int i=0; i<threadsCount; ++i )
+        workers.append( new BatchWorker( this ) );
+
+    // the files are dealt like cards, the stealing takes care of the files that take longer than the others
+    for( int i=0; i<files.size(); ++i )
+        workers[i % threadsCount]->addFile( i );
+
+    writeHeader();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i<workers.size(); ++i )
+        workers[i]->start();
+    for( int i=0; i<workers.size(); ++i )
+        workers[i]->wait();
+
+    elapsedNsecs = timer.nsecsElapsed();
+
+    filesCount = 0;
+    failedFilesCount = 0;
+    pointsCount = 0;
+    for( int i=0; i<workers.size(); ++i )
+    {
+        filesCount += workers[i]->getFilesCount();
+        failedFilesCount += workers[i]->getFailedFilesCount();
+        pointsCount += workers[i]->getPointsCount();
+    }
+
+    output->flush();
+}
+
+bool BatchValidator::stealFile( BatchWorker* thief, int& file )
+{
+    for( int i=0; i<workers.size(); ++i )
+    {
+        if( workers[i] != thief && workers[i]->stealFile( file ) )
+            return true;
+    }
+
+    return false;
+}
+
+// Called from the worker threads: the registry is only read, curve and result belong to the worker
+void BatchValidator::validateFile( int file, Curve& curve, ValidationResult& result, BatchWorker* worker )
+{
+    const QString& filename = files[file];
+    QElapsedTimer timer;
+
+    timer.start();
+    bool loaded = ProbeRecordingReader::isRecording( filename ) ? ProbeRecordingReader::load( filename, curve )
+                                                                : ProbeCurveLoader::load( filename, curve );
+    qint64 loadNsecs = timer.nsecsElapsed();
+
+    worker->filesCount++;
+    if( !loaded )
+    {
+        worker->failedFilesCount++;
+        writeError( filename, loadNsecs );
+        return;
+    }
+    worker->pointsCount += curve.size();
+
+    for( int i=0; i<mannequinIds.size(); ++i )
+    {
+        timer.restart();
+        const Mannequin* mannequin = mannequins->mannequin( mannequinIds[i] );
+        if( failFast )
+            CurveComparer::isCurveValid<Evaluation::FailFast>( mannequin, curve, result );
+        else
+            CurveComparer::isCurveValid<Evaluation::FullDiagnostics>( mannequin, curve, result );
+        qint64 validateNsecs = timer.nsecsElapsed();
+
+        writeResult( filename, mannequinIds[i], result, curve.size(), loadNsecs, validateNsecs );
+    }
+}
+
+void BatchValidator::writeHeader()
+{
+    if( format == Csv )
+        *output << "file;mannequin;status;points;valid;invalid;ignored;ambiguous;median;validLength;mecanicalLength;loadNs;validateNs\n";
+}
+
+void BatchValidator::writeResult( const QString& filename, const QString& mannequinId, const ValidationResult& result,
+                                  int pointsCount, qint64 loadNsecs, qint64 validateNsecs )
+{
+    QString line;
+
+    if( format == Csv )
+    {
+        line = csvField( filename ) + ";" + csvField( mannequinId ) + ";" + CurveValidity::name( result.getStatus() ) + ";"
+             + QString::number( pointsCount ) + ";"
+             + QString::number( result.getValidPointsCount() ) + ";"
+             + QString::number( result.getInvalidPointsCount() ) + ";"
+             + QString::number( result.getIgnoredPointsCount() ) + ";"
+             + QString::number( result.getAmbiguousPointsCount() ) + ";"
+             + QString::number( result.getIntervalStatistics().median ) + ";"
+             + QString::number( result.getValidSegmentLength() ) + ";"
+             + QString::number( result.getMecanicalLength() ) + ";"
+             + QString::number( loadNsecs ) + ";"
+             + QString::number( validateNsecs ) + "\n";
+    }
+    else
+    {
+        line = "{\"file\":" + Json::quote( filename )
+             + ",\"mannequin\":" + Json::quote( mannequinId )
+             + ",\"status\":\"" + CurveValidity::name( result.getStatus() ) + "\""
+             + ",\"points\":" + QString::number( pointsCount )
+             + ",\"valid\":" + QString::number( result.getValidPointsCount() )
+             + ",\"invalid\":" + QString::number( result.getInvalidPointsCount() )
+             + ",\"ignored\":" + QString::number( result.getIgnoredPointsCount() )
+             + ",\"ambiguous\":" + QString::number( result.getAmbiguousPointsCount() )
+             + ",\"median\":" + QString::number( result.getIntervalStatistics().median )
+             + ",\"validLength\":" + QString::number( result.getValidSegmentLength() )
+             + ",\"mecanicalLength\":" + QString::number( result.getMecanicalLength() )
+             + ",\"loadNs\":" + QString::number( loadNsecs )
+             + ",\"validateNs\":" + QString::number( validateNsecs ) + "}\n";
+    }
+
+    // the line is built before taking the lock, so the workers only wait for each other while writing
+    QMutexLocker locker( &outputMutex );
+    *output << line;
+    output->flush();
+}
+
+void BatchValidator::writeError( const QString& filename, qint64 loadNsecs )
+{
+    QString line;
+
+    if( format == Csv )
+        line = csvField( filename ) + ";;FileUnavailable;0;0;0;0;0;;;;" + QString::number( loadNsecs ) + ";0\n";
+    else
+        line = "{\"file\":" + Json::quote( filename ) + ",\"status\":\"FileUnavailable\",\"loadNs\":" + QString::number( loadNsecs ) + "}\n";
+
+    QMutexLocker locker( &outputMutex );
+    *output << line;
+    output->flush();
+}
+
+//  Accessors
+/********************************************************************************/
+
+int BatchValidator::getFilesCount() const
+{
+    return filesCount;
+}
+
+int BatchValidator::getFailedFilesCount() const
+{
+    return failedFilesCount;
+}
+
+qint64 BatchValidator::getPointsCount() const
+{
+    return pointsCount;
+}
+
+qint64 BatchValidator::getElapsedNsecs() const
+{
+    return elapsedNsecs;
+}
+
+double BatchValidator::getFilesPerSecond() const
+{
+    return elapsedNsecs > 0 ? filesCount * 1e9 / elapsedNsecs : 0.0;
+}
+
+double BatchValidator::getPointsPerSecond() const
+{
+    return elapsedNsecs > 0 ? pointsCount * 1e9 / elapsedNsecs : 0.0;
+}
@@ -0,0 +1,103 @@
+#ifndef BATCHVALIDATOR_H
+#define BATCHVALIDATOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QStringList>
+#include <QTextStream>
+
+#include "MannequinRegistry.h"
+#include "ValidationResult.h"
+
+class BatchValidator;
+
+// One thread of the batch. It validates the files of its own queue from the front, and when its queue is empty,
+// it steals files from the back of the queues of the other workers, until every queue is empty.
+class BatchWorker : public QThread
+{
+    friend class BatchValidator;
+
+    private:
+        BatchValidator*     validator;
+        QMutex              queueMutex;
+        QList<int>          queue;          // indexes in BatchValidator::files
+
+        // totals of this worker, read once all the workers are done
+        int                 filesCount;
+        int                 failedFilesCount;
+        qint64              pointsCount;
+
+        bool    popFile( int& file );
+
+    protected:
+        void    run();
+
+    public:
+        BatchWorker( BatchValidator* validator );
+
+        void    addFile( int file );
+        bool    stealFile( int& file );
+
+        int     getFilesCount() const;
+        int     getFailedFilesCount() const;
+        qint64  getPointsCount() const;
+};
+
+// Validate a list of probe curve files against some mannequins of a registry, on several threads.
+// Each file is loaded once and validated against each mannequin, one result line per file and mannequin
+// is written to the output as soon as it is known (csv or json lines).
+class BatchValidator
+{
+    friend class BatchWorker;
+
+    public:
+        enum Format
+        {
+            Csv = 0,
+            Json = 1
+        };
+
+    private:
+        const MannequinRegistry*    mannequins;
+        QStringList                 mannequinIds;
+        QStringList                 files;
+        QList<BatchWorker*>         workers;
+
+        QTextStream*    output;
+        QMutex          outputMutex;
+        Format          format;
+        bool            failFast;       // Evaluation::FailFast, only the status of the results is meaningful
+
+        // totals of the last run()
+        int             filesCount;
+        int             failedFilesCount;
+        qint64          pointsCount;
+        qint64          elapsedNsecs;
+
+        void    validateFile( int file, Curve& curve, ValidationResult& result, BatchWorker* worker );
+        bool    stealFile( BatchWorker* thief, int& file );
+        void    writeHeader();
+        void    writeResult( const QString& filename, const QString& mannequinId, const ValidationResult& result,
+                             int pointsCount, qint64 loadNsecs, qint64 validateNsecs );
+        void    writeError( const QString& filename, qint64 loadNsecs );
+
+        Q_DISABLE_COPY( BatchValidator )
+
+    public:
+        BatchValidator( const MannequinRegistry* mannequins, const QStringList& mannequinIds );
+        ~BatchValidator();
+
+        void    setFailFast( bool enabled );
+        void    run( const QStringList& files, int threadsCount, QTextStream* output, Format format );
+
+        // accessors
+        int     getFilesCount() const;
+        int     getFailedFilesCount() const;
+        qint64  getPointsCount() const;
+        qint64  getElapsedNsecs() const;
+        double  getFilesPerSecond() const;
+        double  getPointsPerSecond() const;
+};
+
+#endif // BATCHVALIDATOR_H
@@ -0,0 +1,38 @@
+#include "Curve.h"
+
+Curve::Curve()
+{
+}
+
+// Empty curve with room for reservedSize points
+Curve::Curve( int reservedSize )
+{
+    reserve( reservedSize );
+}
+
+// Fill arrays with the coordinates of the points, the memory of arrays is reused when it is big enough
+void Curve::toArrays( CurveArrays& arrays ) const
+{
+    arrays.x.resize( size() );
+    arrays.y.resize( size() );
+    arrays.z.resize( size() );
+
+    const Point* points = constData();
+    float* x = arrays.x.data();
+    float* y = arrays.y.data();
+    float* z = arrays.z.data();
+
+    for( int i=0; i<size(); ++i )
+    {
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+}
+
+CurveArrays Curve::toArrays() const
+{
+    CurveArrays arrays;
+    toArrays( arrays );
+    return arrays;
+}
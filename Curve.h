@@ -0,0 +1,29 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <QVector>
+
+#include "Point.h"
+
+// Copy of a curve with x, y and z in separate arrays, for the loops that go through only some of the coordinates
+struct CurveArrays
+{
+    QVector<float> x;
+    QVector<float> y;
+    QVector<float> z;
+
+    int size() const { return y.size(); }
+};
+
+// List of points stored in one contiguous block of memory (a QList<Point> allocates each point separately)
+class Curve : public QVector<Point>
+{
+    public:
+        Curve();
+        explicit Curve( int reservedSize );
+
+        void        toArrays( CurveArrays& arrays ) const;
+        CurveArrays toArrays() const;
+};
+
+#endif // CURVE_H
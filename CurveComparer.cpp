@@ -1,291 +1,431 @@
 #include "CurveComparer.h"
+#include "ValidationSession.h"
+#include "DistanceKernels.h"
+#include "StageMetrics.h"
 
-CurveComparer::CurveComparer()
+CurveComparer::CurveComparer( const MannequinRegistry* mannequins )
 {
-    validity = CurveValidity::NotTested;
-    currentMannequin = 0;
-    probeCurve = 0;
+    this->mannequins = mannequins;
 }
 
-CurveValidity::Status CurveComparer::getValidity() const
+// Start an incremental validation for a probe that sends its points one by one (ex. live tracker input)
+// the session must be deleted by the caller
+ValidationSession* CurveComparer::startSession( const QString& mannequinId ) const
 {
-    return validity;
+    return new ValidationSession( mannequins->mannequin( mannequinId ) );
 }
 
-// Add an additionnal mannequin in the CurveComparer (ex. BOB001, BOB002, ARN001, CAT001, ...)
-void CurveComparer::addMannequin( Mannequin* mannequin )
+// Find the mannequin the curve was recorded on, when its id is not known (see MannequinIdentifier)
+MannequinMatch CurveComparer::findBestMatch( const Curve& curve, int threadsCount ) const
 {
-    mannequins.insert( mannequin->getName(), mannequin );
+    MannequinIdentifier identifier( mannequins );
+    return identifier.identify( curve, threadsCount );
 }
 
-CurveValidity::Status CurveComparer::isCurveValid( const QString& mannequinId, Curve* curve )
+ValidationResult CurveComparer::isCurveValid( const QString& mannequinId, const Curve& curve ) const
 {
-    validity = CurveValidity::NotTested;
-    currentMannequin = mannequins.value( mannequinId );
-    probeCurve = curve;
+    ValidationResult result;
+    isCurveValid( mannequins->mannequin( mannequinId ), curve, result );
+    return result;
+}
+
+// Same as above, but the memory of result is reused
+CurveValidity::Status CurveComparer::isCurveValid( const QString& mannequinId, const Curve& curve, ValidationResult& result ) const
+{
+    return isCurveValid( mannequins->mannequin( mannequinId ), curve, result );
+}
+
+CurveValidity::Status CurveComparer::isCurveValid( const Mannequin* mannequin, const Curve& probeCurve, ValidationResult& result )
+{
+    return isCurveValid<Evaluation::FullDiagnostics>( mannequin, probeCurve, result );
+}
+
+// Same as above, stopped from another thread when cancelled is set to non zero (ValidationWorker): the points are then
+// matched a block at a time and cancelled is read between the blocks. A cancelled result is partial and NotTested.
+CurveValidity::Status CurveComparer::isCurveValid( const Mannequin* mannequin, const Curve& probeCurve, ValidationResult& result, const QAtomicInt& cancelled )
+{
+    return isCurveValid<Evaluation::FullDiagnostics>( mannequin, probeCurve, result, mannequin ? mannequin->getSquaredRadius() : 0.0f, &cancelled );
+}
+
+// Same as above with the evaluation policy, ex. isCurveValid<Evaluation::FailFast>( "BOB002", curve, result )
+template<class Policy>
+CurveValidity::Status CurveComparer::isCurveValid( const QString& mannequinId, const Curve& curve, ValidationResult& result ) const
+{
+    return isCurveValid<Policy>( mannequins->mannequin( mannequinId ), curve, result );
+}
+
+template<class Policy>
+CurveValidity::Status CurveComparer::isCurveValid( const Mannequin* mannequin, const Curve& probeCurve, ValidationResult& result )
+{
+    return isCurveValid<Policy>( mannequin, probeCurve, result, mannequin ? mannequin->getSquaredRadius() : 0.0f );
+}
+
+// The points are valid when their squared distance is not over squaredRadius, the one of the mannequin except for RadiusSweep.
+// Policy::StopAtFirstInvalid is known at compile time, FullDiagnostics compiles to the loop over the whole curve
+template<class Policy>
+CurveValidity::Status CurveComparer::isCurveValid( const Mannequin* mannequin, const Curve& probeCurve, ValidationResult& result, float squaredRadius,
+                                                   const QAtomicInt* cancelled )
+{
+    result.clear( mannequin, probeCurve.size() );
 
     // if the mannequin id received doesn't exist, return false, else test the curve
-    if( !mannequins.contains( mannequinId ) )
+    if( mannequin == 0 )
     {
-        currentMannequin = 0;
-        probeCurve = 0;
-        return CurveValidity::MannequinUnavailable;
+        result.status = CurveValidity::MannequinUnavailable;
+        return result.status;
     }
     else
     {
-        currentMannequin = mannequins.value( mannequinId );
-
         // PROBLEM: If the probe go up and down the eso while recording the points, these additional points should be valid, but
         // this will make the valid segment length go up and the length validity result will be wrong.
 
         // SOLUTION: SORT the non-ignored points (those that need to be tested) by y so that the additional points will give more
         // data, making the curve more accurate. Could be implemented by modifying the setIgnoredPoints() method.
 
-        int validPointsCount = 0;
-        int invalidPointsCount = 0;
-        int ignoredPointsCount = 0;
-
-        int firstValidPointIndex = -1;
-        int lastValidPointIndex = -1;
+        setIgnoredPoints( *mannequin, probeCurve, result );
 
-        setIgnoredPoints();
+        // match all the points with the mecanical curve at once, the distances are compared squared to avoid the sqrt.
+        // To stop at the first invalid point or when cancelled, they are matched a block at a time instead
+        int blockSize = Policy::StopAtFirstInvalid || cancelled ? FailFastBlockSize : probeCurve.size();
+        resizeEquivalentPoints( probeCurve, result );
 
-        // for each points in the probeCurve
-        for( int i=0; i<probeCurve->size(); i++ )
+        for( int blockStart=0; blockStart<probeCurve.size(); blockStart+=blockSize )
         {
-            qDebug() << "Current point : probeCurve[" << i << "]";
-            qDebug() << "Probe point: (" << probePoint(i).x << ", " << probePoint(i).y << ", " << probePoint(i).z << ")";
-
-            // if the point is IGNORED don't test it
-            if( probePoint(i).validity == PointValidity::Ignored )
+            // nobody wants this result anymore
+            if( cancelled && int( *cancelled ) != 0 )
             {
-                ignoredPointsCount++;
-                qDebug() << "This point is ignored.\n";
+                ESO_LOG_DEBUG << "Validation cancelled at point" << blockStart;
+                result.status = CurveValidity::NotTested;
+                return result.status;
             }
-            else
-            {
-                // find the probePoint equivalent in mecanicaCurve where probePoint.y = mecanicalPoint.y
-                // this will always return a point because all the points above the maxY and the points below the first mecanicalPoint.y are set to ignored in defineIgnoredPoints()
-                Point mecanicalPoint = findEquivalentPoint( i );
-                qDebug() << "Mecanical point: (" << mecanicalPoint.x << ", " << mecanicalPoint.y << ", " << mecanicalPoint.z << ")";
-                qDebug() << "Radius: " << currentMannequin->getRadius();
-
-                // determine if the probePoint is within the mecanicalPoint's radius
-                float dist = distanceBetween2Points( mecanicalPoint, probePoint(i) );
-                qDebug() << "Distance: " << dist;
-
-                // the point is VALID
-                if( dist <= currentMannequin->getRadius() )
-                {
-                    probePoint(i).validity = PointValidity::Valid;
 
-                    // keep the first and last valid point in order to calculate the length of the valid segment at the end
-                    // make sure not to set endOfStomach as the first point (all the points between endOfStomach and the first mecanicalPoint will always be ignored)
-                    if( firstValidPointIndex == -1 && mecanicalPoint != currentMannequin->getEndOfStomach() )
-                        firstValidPointIndex = i;
-                    else
-                        lastValidPointIndex = i;
+            int blockEnd = qMin( blockStart + blockSize, probeCurve.size() );
+            findEquivalentPoints( *mannequin, probeCurve, result, blockStart, blockEnd );
+            StageTimer timer( Stage::DistanceTests, blockEnd - blockStart );
+
+            // for each points in the probeCurve
+            for( int i=blockStart; i<blockEnd; i++ )
+            {
+                const Point& probePoint = probeCurve[i];
+                PointValidity::Status& verdict = result.verdicts[i];
 
-                    validPointsCount++;
+                ESO_LOG_TRACE << "Current point : probeCurve[" << i << "]";
+                ESO_LOG_TRACE << "Probe point: (" << probePoint.x << ", " << probePoint.y << ", " << probePoint.z << ")";
 
-                    qDebug() << "This point is valid.\n";
+                // if the point is IGNORED don't test it
+                if( verdict == PointValidity::Ignored )
+                {
+                    result.ignoredPointsCount++;
+                    ESO_LOG_TRACE << "This point is ignored.\n";
                 }
-                // the point is INVALID
                 else
                 {
-                    probePoint(i).validity = PointValidity::Invalid;
-                    invalidPointsCount++;
-                    validity = CurveValidity::Invalid;
+                    // the probePoint equivalent in mecanicaCurve where probePoint.y = mecanicalPoint.y
+                    // there is always one because all the points above the maxY and the points below the first mecanicalPoint.y are set to ignored in defineIgnoredPoints()
+                    const Point& mecanicalPoint = result.matchedPoints[i];
+                    ESO_LOG_TRACE << "Mecanical point: (" << mecanicalPoint.x << ", " << mecanicalPoint.y << ", " << mecanicalPoint.z << ")";
+                    ESO_LOG_TRACE << "Radius: " << mannequin->getRadius();
+                    ESO_LOG_TRACE << "Distance: " << sqrt( result.squaredDistances[i] );
+
+                    // the point is VALID
+                    if( result.squaredDistances[i] <= squaredRadius )
+                    {
+                        verdict = PointValidity::Valid;
+
+                        // keep the first and last valid point in order to calculate the length of the valid segment at the end
+                        // make sure not to set endOfStomach as the first point (all the points between endOfStomach and the first mecanicalPoint will always be ignored)
+                        if( result.firstValidPointIndex == -1 && mecanicalPoint != mannequin->getEndOfStomach() )
+                            result.firstValidPointIndex = i;
+                        else
+                            result.lastValidPointIndex = i;
+
+                        result.validPointsCount++;
+
+                        ESO_LOG_TRACE << "This point is valid.\n";
+                    }
+                    // the point is INVALID
+                    else
+                    {
+                        verdict = PointValidity::Invalid;
+                        result.invalidPointsCount++;
+                        result.status = CurveValidity::Invalid;
+
+                        ESO_LOG_TRACE << "This point is invalid.\n";
+                    }
+                }
+
+                if( result.trace.isEnabled() )
+                    result.trace.record( i, result.matchedPoints[i], result.squaredDistances[i], verdict );
 
-                    qDebug() << "This point is invalid.\n";
+                // the curve is invalid whatever the next points are
+                if( Policy::StopAtFirstInvalid && verdict == PointValidity::Invalid )
+                {
+                    ESO_LOG_DEBUG << "Invalid point" << i << ", the other points are not tested.";
+                    return result.status;
                 }
             }
         }
 
-        qDebug() << "====================================================";
-        qDebug() << "SUMMARY";
-        qDebug() << "====================================================";
-        qDebug() << "Number of curvePoints:" << probeCurve->size();
-        qDebug() << "Valid points:" << validPointsCount;
-        qDebug() << "Invalid points:" << invalidPointsCount;
-        qDebug() << "Ignored points:" << ignoredPointsCount;
-        qDebug() << "First valid point:" << firstValidPointIndex;
-        qDebug() << "Last valid point:" << lastValidPointIndex;
+        ESO_LOG_DEBUG << "====================================================";
+        ESO_LOG_DEBUG << "SUMMARY";
+        ESO_LOG_DEBUG << "====================================================";
+        ESO_LOG_DEBUG << "Number of curvePoints:" << probeCurve.size();
+        ESO_LOG_DEBUG << "Valid points:" << result.validPointsCount;
+        ESO_LOG_DEBUG << "Invalid points:" << result.invalidPointsCount;
+        ESO_LOG_DEBUG << "Ignored points:" << result.ignoredPointsCount;
+        ESO_LOG_DEBUG << "First valid point:" << result.firstValidPointIndex;
+        ESO_LOG_DEBUG << "Last valid point:" << result.lastValidPointIndex;
+
+        if( result.ambiguousPointsCount > 0 )
+            ESO_LOG_WARNING << result.ambiguousPointsCount << "points are at a height reached more than once by the mecanical curve, they were compared to the first one.";
 
         // Check for curve validity
-        if( validity == CurveValidity::NotTested )
-            validity = isThereEnoughData( firstValidPointIndex, lastValidPointIndex );
+        if( result.status == CurveValidity::NotTested )
+            result.status = isThereEnoughData( *mannequin, probeCurve, result );
         else
-            validity = CurveValidity::Invalid;
+            result.status = CurveValidity::Invalid;
 
-        return validity;
+        return result.status;
     }
 }
 
-float CurveComparer::findMedianLength( Curve* curve, int startIndex, int endIndex )
+IntervalStatistics CurveComparer::findIntervalStatistics( const Mannequin& mannequin, const Curve& curve, int startIndex, int endIndex, ValidationResult& result )
 {
+    StageTimer timer( Stage::IntervalMedian, qMax( endIndex - startIndex, 0 ) );
+    IntervalStatistics stats;
+
     // make sure there's at least 2 element (to test at least one segment without crashing)
-    if( endIndex - startIndex + 1 >= 2 )
+    if( startIndex >= 0 && endIndex - startIndex + 1 >= 2 )
     {
-        // a map is used because it is automatically sorted by key
-        // here the key will be the probeCurve.y and the value its index (not used)
-        QMap<float, int> values;
-
-        // set the first min and max with the deltaY of the 2 first points
-        float min = distanceBetween2Points( curve->at(startIndex), curve->at(startIndex+1) );
-        float max = min;
-        float avg = min;
-        float med;
-
-        values.insertMulti( min, 0 );
-
-        // start at the second point since we already did the first
-        for( int i=startIndex+1; i<=endIndex; ++i )
+        // the distances are kept in a buffer reused from one validation to the other,
+        // the median is then found without sorting them
+        // the segment after endIndex is included when it exists, stop at the end of the curve
+        std::vector<float>& intervals = result.intervals;
+        int endPointIndex = qMin( endIndex + 1, curve.size() - 1 );
+        intervals.resize( endPointIndex - startIndex );
+        DistanceKernels::segmentLengths( curve.constData() + startIndex, endPointIndex - startIndex + 1, &intervals[0] );
+
+        float sum = 0.0f;
+        stats.min = intervals[0];
+        stats.max = intervals[0];
+
+        for( size_t i=0; i<intervals.size(); ++i )
         {
-            float dist = distanceBetween2Points( curve->at(i), curve->at(i+1) );
-
-            values.insertMulti( dist, i );
+            if( intervals[i] < stats.min )
+                stats.min = intervals[i];
+            if( intervals[i] > stats.max )
+                stats.max = intervals[i];
 
-            if( dist < min )
-                min = dist;
-            if( dist > max )
-                max = dist;
-
-            avg += dist;
+            sum += intervals[i];
         }
 
-        avg /= values.size();
-
-        int index = values.keys().size() / 2;
-        if( values.keys().size() % 2 != 0 )
-            med = ( values.keys()[index] + values.keys()[index-1] ) / 2;
-        else
-            med = values.keys()[index];
-
-        qDebug() << "Minimum:" << min;
-        qDebug() << "Maximum:" << max;
-        qDebug() << "Average:" << avg;
-        qDebug() << "Median:" << med;
-        qDebug() << "Max median:" << currentMannequin->getMaxIntervalMedian() << "\n";
+        stats.count = intervals.size();
+        stats.avg = sum / stats.count;
+        stats.median = medianOf( intervals );
 
-        return med;
+        ESO_LOG_DEBUG << "Minimum:" << stats.min;
+        ESO_LOG_DEBUG << "Maximum:" << stats.max;
+        ESO_LOG_DEBUG << "Average:" << stats.avg;
+        ESO_LOG_DEBUG << "Median:" << stats.median;
+        ESO_LOG_DEBUG << "Max median:" << mannequin.getMaxIntervalMedian() << "\n";
     }
 
-    return -1;  // median of lengths can't be negative, so this means that there is not enough data
+    return stats;
 }
 
-CurveValidity::Status CurveComparer::isThereEnoughData( int firstValidPointIndex, int lastValidPointIndex )
+CurveValidity::Status CurveComparer::isThereEnoughData( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result )
 {
-    qDebug() << "\nDistance between 2 valid points:";
-    float probeMedian = findMedianLength( probeCurve, firstValidPointIndex, lastValidPointIndex );
+    int firstValidPointIndex = result.firstValidPointIndex;
+    int lastValidPointIndex = result.lastValidPointIndex;
+
+    ESO_LOG_DEBUG << "\nDistance between 2 valid points:";
+    result.intervalStatistics = findIntervalStatistics( mannequin, probeCurve, firstValidPointIndex, lastValidPointIndex, result );
+    float probeMedian = result.intervalStatistics.median;
 
     // Test the median of the length between the points of probeCurve
     // high median = bigger space between points = bad
     // -1 means that there is not enough data to calculate the median
     // mecanical median should always be smaller since we expect the mecanical curve to have more points in the same range of y as the probe curve
     // The test to do (replace this): probeMedian should be smaller than a fixed value (determined in the settings file, by mannequin)
-    if( probeMedian > currentMannequin->getMaxIntervalMedian() || probeMedian == -1 )
+    if( probeMedian > mannequin.getMaxIntervalMedian() || probeMedian == -1 )
         return CurveValidity::NotEnoughDataPoints;
 
-    // calculate the length of the mecanicalCurve and the length of the valid part of the probeCurve
-    float mecanicalLength = segmentLength( currentMannequin, 0, currentMannequin->size() );
-    float probeValidSegmentLength = segmentLength( probeCurve, firstValidPointIndex, lastValidPointIndex );
+    // the length of the mecanicalCurve is calculated once when the mannequin is loaded, only the valid part of the probeCurve is calculated
+    float mecanicalLength = mannequin.getLength();
+    float probeValidSegmentLength = segmentLength( probeCurve, firstValidPointIndex, lastValidPointIndex, result );
+    result.mecanicalLength = mecanicalLength;
+    result.validSegmentLength = probeValidSegmentLength;
 
-    qDebug() << "Mecanical curve length:" << mecanicalLength;
-    qDebug() << "Probe valid segment length:" << probeValidSegmentLength;
-    qDebug() << "Minimum valid length:" << (1.0f - currentMannequin->getCurveLengthThreshold()) * mecanicalLength << "\n";
+    ESO_LOG_DEBUG << "Mecanical curve length:" << mecanicalLength;
+    ESO_LOG_DEBUG << "Probe valid segment length:" << probeValidSegmentLength;
+    ESO_LOG_DEBUG << "Minimum valid length:" << (1.0f - mannequin.getCurveLengthThreshold()) * mecanicalLength << "\n";
 
     // Test the length of the valid segment
     // if the valid length is bigger than a certain threshold of mecanicalLength's length, it's invalid
-    if( fabs( mecanicalLength - probeValidSegmentLength ) > currentMannequin->getCurveLengthThreshold() * mecanicalLength )
+    if( fabs( mecanicalLength - probeValidSegmentLength ) > mannequin.getCurveLengthThreshold() * mecanicalLength )
         return CurveValidity::NotEnoughDataLength;
 
     return CurveValidity::Valid;
 }
 
-Point CurveComparer::findEquivalentPoint( int probePointIndex )
+// Size the buffers of the equivalent points for the whole probe curve
+void CurveComparer::resizeEquivalentPoints( const Curve& probeCurve, ValidationResult& result )
 {
-    // it's the first point in the list, compare it to the endOfStomach point
-    if( probePointIndex == 0 )
-        return currentMannequin->getEndOfStomach();
+    int count = probeCurve.size();
+    result.pointAfterIndexes.resize( count );
+    result.matchedPoints.resize( count );
+    result.squaredDistances.resize( count );
+}
+
+// Find the probePoint equivalent in the mecanical curve (where probePoint.y = mecanicalPoint.y) of all the points that are not ignored,
+// and their squared distance. The results are in result.matchedPoints and result.squaredDistances.
+void CurveComparer::findEquivalentPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result )
+{
+    resizeEquivalentPoints( probeCurve, result );
+    findEquivalentPoints( mannequin, probeCurve, result, 0, probeCurve.size() );
+}
+
+// Same as above for the points from startIndex to endIndex (excluded), the buffers must already have the size of the curve
+void CurveComparer::findEquivalentPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result, int startIndex, int endIndex )
+{
+    if( startIndex >= endIndex )
+        return;
+
+    StageTimer timer( Stage::PointMatching, endIndex - startIndex );
+
+    if( mannequin.getMatching() == Matching::ClosestPoint )
+    {
+        findClosestPoints( mannequin, probeCurve, result, startIndex, endIndex );
+        return;
+    }
+
+    // the first point of the curve is compared to endOfStomach below
+    int firstIndex = qMax( startIndex, 1 );
 
-    // Search for the point after the one we are looking for (the first mecanical point with mecanicalPoint.y > probePoint.y)
-    int pointAfterIndex = -1;
-    for( int i=1; i<currentMannequin->size(); ++i )
+    for( int i=firstIndex; i<endIndex; ++i )
     {
-        // If the mecanicalCurve has a point with the exact same y as probePoint, return it as result
-        // this point has validity = CurveNotTested (set in the constructor (float, float, float) )
-        if( mecanicalPoint(i).y == probePoint(probePointIndex).y )
-            return mecanicalPoint(i);
-        // choose the first point with mecanicalPoint.y > probePoint.y
-        else if( mecanicalPoint(i).y > probePoint(probePointIndex).y )
+        if( result.verdicts[i] == PointValidity::Ignored )
         {
-            pointAfterIndex = i;
-            break;
+            result.pointAfterIndexes[i] = 1;    // not used, any segment of the curve will do
+            continue;
         }
+
+        // Search for the point after the one we are looking for (the first mecanical point with mecanicalPoint.y >= probePoint.y)
+        // with the y index of the mannequin instead of going through the whole curve
+        int pointAfterIndex = mannequin.findPointAfter( probeCurve[i].y );
+
+        // the probe point is above the last mecanical point (maxY is set higher than the mecanical curve),
+        // extend the last segment of the curve
+        if( pointAfterIndex == mannequin.size() )
+            pointAfterIndex = mannequin.size() - 1;
+
+        // the mecanical curve reaches this y more than once, only the first one is used
+        if( mannequin.isAmbiguousY( probeCurve[i].y ) && mannequin[pointAfterIndex].y != probeCurve[i].y )
+            result.ambiguousPointsCount++;
+
+        result.pointAfterIndexes[i] = pointAfterIndex;
+    }
+
+    // the point between pointAfterIndex and pointAfterIndex-1 with y = probePoint.y, or the mecanical point itself if it has the same y
+    if( firstIndex < endIndex )
+        DistanceKernels::matchAtY( probeCurve.constData() + firstIndex, &result.pointAfterIndexes[0] + firstIndex, mannequin.constData(), endIndex - firstIndex,
+                                   &result.matchedPoints[0] + firstIndex, &result.squaredDistances[0] + firstIndex );
+
+    // it's the first point in the list, compare it to the endOfStomach point
+    if( startIndex == 0 )
+    {
+        result.matchedPoints[0] = mannequin.getEndOfStomach();
+        result.squaredDistances[0] = DistanceKernels::squaredDistance( result.matchedPoints[0], probeCurve[0] );
     }
+}
 
-    // Return the point between pointAfterIndex and pointAfterIndex-1 with y = probePoint.y
+// Same as findEquivalentPoints(), but with the point of the mecanical curve closest to each probe point in 3d,
+// instead of the one at the same y. It doesn't depend on the curve being monotonic in y (no ambiguous points).
+void CurveComparer::findClosestPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result, int startIndex, int endIndex )
+{
+    for( int i=qMax( startIndex, 1 ); i<endIndex; ++i )
+    {
+        if( result.verdicts[i] == PointValidity::Ignored )
+        {
+            result.pointAfterIndexes[i] = 1;
+            result.matchedPoints[i] = mannequin[1];
+            result.squaredDistances[i] = DistanceKernels::squaredDistance( mannequin[1], probeCurve[i] );
+            continue;
+        }
 
-    // targetCurve[after] is the point after (on the y axis) the one we are searching
-    // targetCurve[after-1] is the point before (on the y axis) the one we are searching
-    // there should never be an out of range problem with targetCurve[after-1] since after cannot be the first Point in the list.
+        int segment;
+        result.matchedPoints[i] = mannequin.findClosestPoint( probeCurve[i], &segment, &result.squaredDistances[i] );
+        result.pointAfterIndexes[i] = segment + 1;
+    }
 
-    // these 2 are just for readability
-    Point before = mecanicalPoint(pointAfterIndex-1);
-    Point after = mecanicalPoint(pointAfterIndex);
+    // it's the first point in the list, compare it to the endOfStomach point
+    if( startIndex == 0 )
+    {
+        result.matchedPoints[0] = mannequin.getEndOfStomach();
+        result.squaredDistances[0] = DistanceKernels::squaredDistance( result.matchedPoints[0], probeCurve[0] );
+    }
+}
 
+// Return the point of the segment [before, after] at the height y
+Point CurveComparer::pointAtY( const Point& before, const Point& after, float y )
+{
     Point line( after.x - before.x,
                 after.y - before.y,
                 after.z - before.z );
-    float t = (probePoint(probePointIndex).y - before.y) / line.y;
+    float t = (y - before.y) / line.y;
 
     float x = before.x + line.x * t;
-    float y = probePoint(probePointIndex).y;
     float z = before.z + line.z * t;
 
     return Point(x, y, z);
 }
 
-float CurveComparer::segmentLength( Curve* curve, int startIndex, int endIndex )
+float CurveComparer::segmentLength( const Curve& curve, int startIndex, int endIndex, ValidationResult& result )
 {
-    float result = 0.0f;
+    StageTimer timer( Stage::SegmentLength, qMax( endIndex - startIndex, 0 ) );
+    float length = 0.0f;
 
-    // go through all the points from startIndex to endIndex and calculate the total
-    // length of the segment
-    for( int i=startIndex; i<endIndex-1; ++i )
-    {
-        result += distanceBetween2Points( (*curve)[i], (*curve)[i+1] );
-    }
+    if( endIndex - startIndex < 2 )
+        return length;
 
-    return result;
+    // calculate the length of all the segments from startIndex to endIndex at once,
+    // then add them in order to get the total length of the segment
+    std::vector<float>& lengths = result.lengths;
+    lengths.resize( endIndex - startIndex - 1 );
+    DistanceKernels::segmentLengths( curve.constData() + startIndex, endIndex - startIndex, &lengths[0] );
+
+    for( size_t i=0; i<lengths.size(); ++i )
+        length += lengths[i];
+
+    return length;
 }
 
-void CurveComparer::setIgnoredPoints()
+void CurveComparer::setIgnoredPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result )
 {
+    StageTimer timer( Stage::IgnoreMarking, probeCurve.size() );
     int i;
-    for( i=0; i<probeCurve->size(); ++i )
+    for( i=0; i<probeCurve.size(); ++i )
     {
         // beginning of the mecanical curve (bottom):
         // except the first element (it has to be tested with endOfStomach)
         // all points with a y lower than the first mecanicalCurve point are ignored
-        if( i > 0 && probePoint(i).y < mecanicalPoint(0).y )
-            probePoint(i).validity = PointValidity::Ignored;
+        if( i > 0 && probeCurve[i].y < mannequin[0].y )
+            result.verdicts[i] = PointValidity::Ignored;
 
         // end of the mecanical curve (top):
         // find the first point with an y > pointMaxY
         // from this point on, points should not be tested (most of them are supposed to be outside the mannequin)
-        if( probePoint(i).y > currentMannequin->getMaxY() )
+        if( probeCurve[i].y > mannequin.getMaxY() )
         {
-            probePoint(i).validity = PointValidity::Ignored;
+            result.verdicts[i] = PointValidity::Ignored;
             break;
         }
     }
 
     // once you found it, set its validity and all the following points to Ignored
-    for( int j=i+1; j<probeCurve->size(); ++j )
+    for( int j=i+1; j<probeCurve.size(); ++j )
     {
-        probePoint(j).validity = PointValidity::Ignored;
+        result.verdicts[j] = PointValidity::Ignored;
     }
 }
 
@@ -300,37 +440,20 @@ float CurveComparer::distanceBetween2Points( const Point& p1, const Point& p2 )
     return sqrt( dx*dx + dy*dy + dz*dz );
 }
 
-//  Accessors for members variables, for the OpenGL view
+//  Accessors
 /********************************************************************************/
 
-Mannequin* CurveComparer::getCurrentMannequin() const
-{
-    return currentMannequin;
-}
-
-Curve* CurveComparer::getProbeCurve() const
-{
-    return probeCurve;
-}
-
-// these 2 are just for code readability, private
-Point& CurveComparer::probePoint( int i )
-{
-    return (*probeCurve)[i];
-}
-
-Point& CurveComparer::mecanicalPoint( int i )
+const MannequinRegistry* CurveComparer::getMannequins() const
 {
-    return (*currentMannequin)[i];
+    return mannequins;
 }
 
-// these 2 are public
-Point CurveComparer::getProbePoint( int i ) const
-{
-    return (*probeCurve)[i];
-}
+//  Evaluation policies
+/********************************************************************************/
 
-Point CurveComparer::getMecanicalPoint( int i ) const
-{
-    return (*currentMannequin)[i];
-}
+// isCurveValid() is only compiled for these policies, a new one must be added here
+template CurveValidity::Status CurveComparer::isCurveValid<Evaluation::FullDiagnostics>( const QString&, const Curve&, ValidationResult& ) const;
+template CurveValidity::Status CurveComparer::isCurveValid<Evaluation::FailFast>( const QString&, const Curve&, ValidationResult& ) const;
+template CurveValidity::Status CurveComparer::isCurveValid<Evaluation::FullDiagnostics>( const Mannequin*, const Curve&, ValidationResult& );
+template CurveValidity::Status CurveComparer::isCurveValid<Evaluation::FailFast>( const Mannequin*, const Curve&, ValidationResult& );
+template CurveValidity::Status CurveComparer::isCurveValid<Evaluation::FullDiagnostics>( const Mannequin*, const Curve&, ValidationResult&, float, const QAtomicInt* );
@@ -2,55 +2,81 @@
 #define CURVECOMPARER_H
 
 #include <cmath>
-#include <QDebug>
+#include <QAtomicInt>
 
+#include "Log.h"
 #include "Mannequin.h"
+#include "MannequinRegistry.h"
+#include "MannequinIdentifier.h"
+#include "IntervalStatistics.h"
+#include "ValidationResult.h"
 
-namespace CurveValidity
+class ValidationSession;
+
+// How much of the curve isCurveValid() goes through, chosen at compile time with its template parameter
+// (only these two are compiled, see the end of CurveComparer.cpp)
+namespace Evaluation
 {
-    enum Status
+    // every point gets its verdict, the median and the lengths are computed (GL view, traces, batch and regression results)
+    struct FullDiagnostics
     {
-        NotTested = 0,
-        Valid = 1,
-        Invalid = 2,
-        NotEnoughDataLength = 3,
-        NotEnoughDataPoints = 4,
-        MannequinUnavailable = 5
+        enum { StopAtFirstInvalid = 0 };
+    };
+
+    // stop at the first invalid point, the curve is Invalid whatever the other points are.
+    // Only the status is meaningful then, the verdicts and counts stop at this point (pass/fail servers)
+    struct FailFast
+    {
+        enum { StopAtFirstInvalid = 1 };
     };
 }
 
+// Compare probe curves to the mecanical curves of the mannequins of a registry.
+// The comparer has no state of its own: everything about a validation goes in its ValidationResult,
+// so one comparer can validate several curves at the same time from different threads.
 class CurveComparer
 {
+    friend class Benchmark;     // times the stages one by one (benchmark.cpp)
+    friend class RadiusSweep;
+
     private:
-        QMap<QString, Mannequin*>   mannequins;
-        Mannequin*                  currentMannequin;
-        Curve*                      probeCurve;
-        CurveValidity::Status       validity;
-
-        float   segmentLength( Curve* curve, int startIndex, int endIndex );
-        float   distanceBetween2Points( const Point& p1, const Point& p2 );
-        Point   findEquivalentPoint( int provePointIndex );
-        void    setIgnoredPoints();
-        float   findMedianLength( Curve* curve, int startIndex, int endIndex );
-        CurveValidity::Status isThereEnoughData( int firstValidPointIndex, int lastValidPointIndex );
-
-        // shortcuts
-        Point&  mecanicalPoint( int i );
-        Point&  probePoint( int i );
+        const MannequinRegistry*    mannequins;
+
+        static const int FailFastBlockSize = 64;   // points matched at once before testing them, with Evaluation::FailFast or a cancel flag
+
+        template<class Policy>
+        static CurveValidity::Status isCurveValid( const Mannequin* mannequin, const Curve& curve, ValidationResult& result, float squaredRadius,
+                                                   const QAtomicInt* cancelled = 0 );
+
+        static float    segmentLength( const Curve& curve, int startIndex, int endIndex, ValidationResult& result );
+        static void     resizeEquivalentPoints( const Curve& probeCurve, ValidationResult& result );
+        static void     findEquivalentPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result );
+        static void     findEquivalentPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result, int startIndex, int endIndex );
+        static void     findClosestPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result, int startIndex, int endIndex );
+        static void     setIgnoredPoints( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result );
+        static IntervalStatistics findIntervalStatistics( const Mannequin& mannequin, const Curve& curve, int startIndex, int endIndex, ValidationResult& result );
+        static CurveValidity::Status isThereEnoughData( const Mannequin& mannequin, const Curve& probeCurve, ValidationResult& result );
 
     public:
-        CurveComparer();
+        CurveComparer( const MannequinRegistry* mannequins );
 
-        CurveValidity::Status   isCurveValid( const QString& mannequinId, Curve* curve );
-        void                    addMannequin( Mannequin* mannequin );
+        ValidationResult        isCurveValid( const QString& mannequinId, const Curve& curve ) const;
+        CurveValidity::Status   isCurveValid( const QString& mannequinId, const Curve& curve, ValidationResult& result ) const;
+        static CurveValidity::Status isCurveValid( const Mannequin* mannequin, const Curve& curve, ValidationResult& result );
+        template<class Policy>
+        CurveValidity::Status   isCurveValid( const QString& mannequinId, const Curve& curve, ValidationResult& result ) const;
+        template<class Policy>
+        static CurveValidity::Status isCurveValid( const Mannequin* mannequin, const Curve& curve, ValidationResult& result );
+        static CurveValidity::Status isCurveValid( const Mannequin* mannequin, const Curve& curve, ValidationResult& result, const QAtomicInt& cancelled );
+        ValidationSession*      startSession( const QString& mannequinId ) const;
+        MannequinMatch          findBestMatch( const Curve& curve, int threadsCount ) const;
 
-        // accessors
-        CurveValidity::Status getValidity() const;
-        Curve*      getProbeCurve() const;
-        Mannequin*  getCurrentMannequin() const;
-        Point       getMecanicalPoint( int i ) const;
-        Point       getProbePoint( int i ) const;
+        // geometry helpers, shared with ValidationSession
+        static float    distanceBetween2Points( const Point& p1, const Point& p2 );
+        static Point    pointAtY( const Point& before, const Point& after, float y );
 
+        // accessors
+        const MannequinRegistry* getMannequins() const;
 };
 
 #endif // CURVECOMPARER_H
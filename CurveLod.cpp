@@ -0,0 +1,181 @@
+#include "CurveLod.h"
+
+#include <algorithm>
+
+#include "CurveComparer.h"
+
+CurveLod::CurveLod()
+{
+    clear();
+}
+
+void CurveLod::clear()
+{
+    levels.clear();
+    verdicts.clear();
+    size = 0;
+    length = 0.0;
+}
+
+// Take into account the points appended to curve and the verdicts changed since the last update.
+// The points already taken into account must not change, clear() first to start over with another curve.
+void CurveLod::update( const Curve& curve, const QVector<PointValidity::Status>& newVerdicts )
+{
+    int newSize = qMin( curve.size(), newVerdicts.size() );
+
+    // first point with another verdict, or the first new point
+    int firstChanged = qMin( size, newSize );
+    for( int i=0; i<firstChanged; ++i )
+    {
+        if( newVerdicts[i] != verdicts[i] )
+        {
+            firstChanged = i;
+            break;
+        }
+    }
+
+    if( firstChanged == size && newSize == size )
+        return;
+
+    // length of the segments appended (or of the whole curve again if it is shorter)
+    if( newSize < size )
+    {
+        length = 0.0;
+        for( int i=0; i<newSize-1; ++i )
+            length += CurveComparer::distanceBetween2Points( curve[i], curve[i+1] );
+    }
+    else
+    {
+        for( int i=qMax( size - 1, 0 ); i<newSize-1; ++i )
+            length += CurveComparer::distanceBetween2Points( curve[i], curve[i+1] );
+    }
+
+    verdicts.resize( newSize );
+    for( int i=firstChanged; i<newSize; ++i )
+        verdicts[i] = newVerdicts[i];
+    size = newSize;
+
+    // whether a point is next to a change of verdict depends on the point before it too
+    int from = qMax( firstChanged - 1, 0 );
+
+    int levelsCount = 0;
+    while( ( size >> ( levelsCount + 1 ) ) >= MinBucketsCount )
+        levelsCount++;
+
+    int builtLevels = levels.size();
+    levels.resize( levelsCount );
+
+    for( int level=1; level<=levelsCount; ++level )
+    {
+        // a new level is built from the beginning
+        if( level > builtLevels )
+        {
+            levels[level-1].indexes.clear();
+            levels[level-1].dirtyFrom = 0;
+            buildLevel( level, curve, 0 );
+        }
+        else
+            buildLevel( level, curve, from );
+    }
+}
+
+// Build the level again from the bucket of the point from to the end of the curve
+void CurveLod::buildLevel( int level, const Curve& curve, int from )
+{
+    int bucketSize = 1 << level;
+    int firstBucket = from / bucketSize * bucketSize;
+
+    QVector<int>& indexes = levels[level-1].indexes;
+    int position = std::lower_bound( indexes.begin(), indexes.end(), firstBucket ) - indexes.begin();
+    indexes.resize( position );
+    levels[level-1].dirtyFrom = qMin( levels[level-1].dirtyFrom, position );
+
+    // the points kept by the level below, from firstBucket (all the points for the level 1)
+    const QVector<int>* source = ( level > 1 ) ? &levels[level-2].indexes : 0;
+    int sourcePosition = source ? std::lower_bound( source->begin(), source->end(), firstBucket ) - source->begin() : firstBucket;
+    int sourceSize = source ? source->size() : size;
+
+    for( int bucket=firstBucket; bucket<size; bucket+=bucketSize )
+    {
+        int bucketEnd = qMin( bucket + bucketSize, size );
+        int lowest = -1;
+        int highest = -1;
+
+        // the first point of the bucket is always kept by the level below
+        int first = indexes.size();
+        for( ; sourcePosition<sourceSize; ++sourcePosition )
+        {
+            int i = source ? (*source)[sourcePosition] : sourcePosition;
+            if( i >= bucketEnd )
+                break;
+
+            if( lowest == -1 || curve[i].y < curve[lowest].y )
+                lowest = i;
+            if( highest == -1 || curve[i].y > curve[highest].y )
+                highest = i;
+
+            if( i == bucket || i == size - 1 || isBoundary( i ) )
+                indexes.append( i );
+        }
+
+        // add the lowest and highest points in their place
+        int extremes[2] = { lowest, highest };
+        for( int e=0; e<2; ++e )
+        {
+            if( extremes[e] == -1 )
+                continue;
+
+            QVector<int>::iterator place = std::lower_bound( indexes.begin() + first, indexes.end(), extremes[e] );
+            if( place == indexes.end() || *place != extremes[e] )
+                indexes.insert( place - indexes.begin(), extremes[e] );
+        }
+    }
+}
+
+// The point is next to a change of verdict
+bool CurveLod::isBoundary( int i ) const
+{
+    return ( i > 0 && verdicts[i] != verdicts[i-1] ) ||
+           ( i < size - 1 && verdicts[i] != verdicts[i+1] );
+}
+
+// Levels built, including the level 0 (the curve itself)
+int CurveLod::levelsCount() const
+{
+    return levels.size() + 1;
+}
+
+// Points kept by a level from 1 to levelsCount() - 1, in order
+const QVector<int>& CurveLod::indexes( int level ) const
+{
+    return levels[level-1].indexes;
+}
+
+// First position of indexes( level ) changed since setClean( level ), indexes( level ).size() if none
+int CurveLod::dirtyFrom( int level ) const
+{
+    return qMin( levels[level-1].dirtyFrom, levels[level-1].indexes.size() );
+}
+
+void CurveLod::setClean( int level )
+{
+    levels[level-1].dirtyFrom = levels[level-1].indexes.size();
+}
+
+// Average length of a segment of the curve
+float CurveLod::averageSpacing() const
+{
+    return ( size > 1 ) ? length / ( size - 1 ) : 0.0f;
+}
+
+// Coarsest level whose points are on average not farther than maxSpacing from each other
+int CurveLod::levelFor( float maxSpacing ) const
+{
+    float spacing = averageSpacing();
+    int level = 0;
+
+    while( level + 1 < levelsCount() && spacing * ( 1 << ( level + 1 ) ) <= maxSpacing )
+        level++;
+
+    return level;
+}
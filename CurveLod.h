@@ -0,0 +1,50 @@
+#ifndef CURVELOD_H
+#define CURVELOD_H
+
+#include <QVector>
+
+#include "Curve.h"
+
+// Levels of detail of a long probe curve, to draw fewer points when they are closer than a pixel on screen.
+//
+// The level L cuts the curve in buckets of 2^L points and keeps in each bucket its first point, its lowest and highest point
+// (min/max in y, the main direction of the curve) and every point next to a change of verdict, plus the last point of the curve.
+// Since the points on both sides of a change of verdict are always kept, the segments between 2 kept points have the same
+// color as all the segments they replace: the valid/invalid boundaries are exact at every level.
+//
+// The level L is built from the points kept by the level L-1, so appending points only rebuilds the last bucket of each level.
+class CurveLod
+{
+    private:
+        struct Level
+        {
+            QVector<int>    indexes;    // points kept, in order
+            int             dirtyFrom;  // first position of indexes changed since setClean()
+        };
+
+        QVector<Level>                  levels;     // levels[0] is the level 1, the level 0 is the curve itself
+        QVector<PointValidity::Status>  verdicts;   // verdicts of the points taken into account
+        int                             size;
+        double                          length;     // of the curve, for averageSpacing()
+
+        static const int MinBucketsCount = 64;      // a level has at least this many buckets, or it is not built
+
+        bool isBoundary( int i ) const;
+        void buildLevel( int level, const Curve& curve, int from );
+
+    public:
+        CurveLod();
+
+        void    clear();
+        void    update( const Curve& curve, const QVector<PointValidity::Status>& verdicts );
+
+        int     levelsCount() const;
+        const QVector<int>& indexes( int level ) const;
+        int     dirtyFrom( int level ) const;
+        void    setClean( int level );
+
+        float   averageSpacing() const;
+        int     levelFor( float maxSpacing ) const;
+};
+
+#endif // CURVELOD_H
@@ -0,0 +1,372 @@
+#include "DistanceKernels.h"
+
+#include <cmath>
+#include <math.h>
+
+#if !defined(ESO_NO_SIMD) && defined(__SSE2__)
+    #define ESO_KERNELS_SSE
+    #include <emmintrin.h>
+#endif
+
+// the AVX functions are compiled for AVX on their own, the rest of the program doesn't need -mavx
+#if !defined(ESO_NO_SIMD) && ( defined(__x86_64__) || defined(__i386__) ) && \
+    ( defined(__clang__) || ( defined(__GNUC__) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) )
+    #define ESO_KERNELS_AVX
+    #define ESO_TARGET_AVX __attribute__(( target("avx") ))
+    #include <immintrin.h>
+    #include <cpuid.h>
+#endif
+
+// the SIMD versions load a whole Point (x, y, z, validity) in 4 floats
+typedef char PointIsFourFloats[ sizeof(Point) == 4 * sizeof(float) ? 1 : -1 ];
+
+namespace DistanceKernels
+{
+
+//  Scalar versions, also used for the points left at the end of the SIMD versions
+/********************************************************************************/
+
+static void segmentLengthsScalar( const Point* points, int start, int count, float* lengths )
+{
+    for( int i=start; i<count-1; ++i )
+        lengths[i] = sqrt( squaredDistance( points[i], points[i+1] ) );
+}
+
+static void matchAtYScalar( const Point* probe, const int* pointAfter, const Point* mecanical, int start, int count,
+                            Point* matched, float* squaredDistances )
+{
+    for( int i=start; i<count; ++i )
+    {
+        const Point& before = mecanical[pointAfter[i]-1];
+        const Point& after = mecanical[pointAfter[i]];
+        float y = probe[i].y;
+
+        // same as CurveComparer::pointAtY()
+        if( after.y == y )
+            matched[i] = Point( after.x, after.y, after.z );
+        else
+        {
+            float lineX = after.x - before.x;
+            float lineY = after.y - before.y;
+            float lineZ = after.z - before.z;
+            float t = (y - before.y) / lineY;
+
+            matched[i] = Point( before.x + lineX * t, y, before.z + lineZ * t );
+        }
+
+        squaredDistances[i] = squaredDistance( matched[i], probe[i] );
+    }
+}
+
+//  SSE versions, 4 points at a time
+/********************************************************************************/
+
+#ifdef ESO_KERNELS_SSE
+
+// 4 points to x, y and z vectors
+static inline void loadPoints( const Point* p0, const Point* p1, const Point* p2, const Point* p3,
+                               __m128& x, __m128& y, __m128& z )
+{
+    __m128 r0 = _mm_loadu_ps( &p0->x );
+    __m128 r1 = _mm_loadu_ps( &p1->x );
+    __m128 r2 = _mm_loadu_ps( &p2->x );
+    __m128 r3 = _mm_loadu_ps( &p3->x );
+    _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+
+    x = r0;
+    y = r1;
+    z = r2;
+}
+
+static inline __m128 squaredDistanceSSE( __m128 x1, __m128 y1, __m128 z1, __m128 x2, __m128 y2, __m128 z2 )
+{
+    __m128 dx = _mm_sub_ps( x1, x2 );
+    __m128 dy = _mm_sub_ps( y1, y2 );
+    __m128 dz = _mm_sub_ps( z1, z2 );
+
+    return _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) );
+}
+
+static void segmentLengthsSSE( const Point* points, int count, float* lengths )
+{
+    int i = 0;
+    for( ; i+4<count; i+=4 )
+    {
+        __m128 x1, y1, z1, x2, y2, z2;
+        loadPoints( points+i, points+i+1, points+i+2, points+i+3, x1, y1, z1 );
+        loadPoints( points+i+1, points+i+2, points+i+3, points+i+4, x2, y2, z2 );
+
+        _mm_storeu_ps( lengths+i, _mm_sqrt_ps( squaredDistanceSSE( x1, y1, z1, x2, y2, z2 ) ) );
+    }
+
+    segmentLengthsScalar( points, i, count, lengths );
+}
+
+static void matchAtYSSE( const Point* probe, const int* pointAfter, const Point* mecanical, int count,
+                         Point* matched, float* squaredDistances )
+{
+    int i = 0;
+    for( ; i+4<=count; i+=4 )
+    {
+        const int* after = pointAfter + i;
+
+        __m128 bx, by, bz, ax, ay, az, px, py, pz;
+        loadPoints( mecanical+after[0]-1, mecanical+after[1]-1, mecanical+after[2]-1, mecanical+after[3]-1, bx, by, bz );
+        loadPoints( mecanical+after[0], mecanical+after[1], mecanical+after[2], mecanical+after[3], ax, ay, az );
+        loadPoints( probe+i, probe+i+1, probe+i+2, probe+i+3, px, py, pz );
+
+        // point of the segment at the probe y
+        __m128 t = _mm_div_ps( _mm_sub_ps( py, by ), _mm_sub_ps( ay, by ) );
+        __m128 mx = _mm_add_ps( bx, _mm_mul_ps( _mm_sub_ps( ax, bx ), t ) );
+        __m128 mz = _mm_add_ps( bz, _mm_mul_ps( _mm_sub_ps( az, bz ), t ) );
+
+        // or the mecanical point itself when it has the same y
+        __m128 same = _mm_cmpeq_ps( ay, py );
+        mx = _mm_or_ps( _mm_and_ps( same, ax ), _mm_andnot_ps( same, mx ) );
+        mz = _mm_or_ps( _mm_and_ps( same, az ), _mm_andnot_ps( same, mz ) );
+        __m128 my = py;
+
+        _mm_storeu_ps( squaredDistances+i, squaredDistanceSSE( mx, my, mz, px, py, pz ) );
+
+        // back to points, the validity (4th float) is 0 = NotTested
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS( mx, my, mz, w );
+        _mm_storeu_ps( &matched[i].x, mx );
+        _mm_storeu_ps( &matched[i+1].x, my );
+        _mm_storeu_ps( &matched[i+2].x, mz );
+        _mm_storeu_ps( &matched[i+3].x, w );
+    }
+
+    matchAtYScalar( probe, pointAfter, mecanical, i, count, matched, squaredDistances );
+}
+
+#endif // ESO_KERNELS_SSE
+
+//  AVX versions, 8 points at a time
+/********************************************************************************/
+
+#ifdef ESO_KERNELS_AVX
+
+static bool cpuSupportsAvx()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+        return false;
+
+    // the cpu must have AVX and the OS must save the AVX registers
+    if( ( ecx & bit_AVX ) == 0 || ( ecx & bit_OSXSAVE ) == 0 )
+        return false;
+
+    unsigned int xcr0Low, xcr0High;
+    __asm__ __volatile__( "xgetbv" : "=a"( xcr0Low ), "=d"( xcr0High ) : "c"( 0 ) );
+
+    return ( xcr0Low & 6 ) == 6;
+}
+
+// 8 points to x, y and z vectors: each 128 bits half is transposed like with SSE,
+// the low half has the points 0 to 3 and the high half the points 4 to 7
+static inline ESO_TARGET_AVX __m256 loadPair( const Point* low, const Point* high )
+{
+    return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( &low->x ) ), _mm_loadu_ps( &high->x ), 1 );
+}
+
+static inline ESO_TARGET_AVX void transpose( __m256& r0, __m256& r1, __m256& r2, __m256& r3 )
+{
+    __m256 t0 = _mm256_unpacklo_ps( r0, r1 );
+    __m256 t1 = _mm256_unpackhi_ps( r0, r1 );
+    __m256 t2 = _mm256_unpacklo_ps( r2, r3 );
+    __m256 t3 = _mm256_unpackhi_ps( r2, r3 );
+
+    r0 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE(1, 0, 1, 0) );
+    r1 = _mm256_shuffle_ps( t0, t2, _MM_SHUFFLE(3, 2, 3, 2) );
+    r2 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE(1, 0, 1, 0) );
+    r3 = _mm256_shuffle_ps( t1, t3, _MM_SHUFFLE(3, 2, 3, 2) );
+}
+
+static inline ESO_TARGET_AVX void loadPoints( const Point* const* p, __m256& x, __m256& y, __m256& z )
+{
+    __m256 r0 = loadPair( p[0], p[4] );
+    __m256 r1 = loadPair( p[1], p[5] );
+    __m256 r2 = loadPair( p[2], p[6] );
+    __m256 r3 = loadPair( p[3], p[7] );
+    transpose( r0, r1, r2, r3 );
+
+    x = r0;
+    y = r1;
+    z = r2;
+}
+
+static inline ESO_TARGET_AVX void loadPoints( const Point* points, __m256& x, __m256& y, __m256& z )
+{
+    const Point* p[8] = { points, points+1, points+2, points+3, points+4, points+5, points+6, points+7 };
+    loadPoints( p, x, y, z );
+}
+
+static inline ESO_TARGET_AVX __m256 squaredDistanceAVX( __m256 x1, __m256 y1, __m256 z1, __m256 x2, __m256 y2, __m256 z2 )
+{
+    __m256 dx = _mm256_sub_ps( x1, x2 );
+    __m256 dy = _mm256_sub_ps( y1, y2 );
+    __m256 dz = _mm256_sub_ps( z1, z2 );
+
+    return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ), _mm256_mul_ps( dz, dz ) );
+}
+
+static ESO_TARGET_AVX void segmentLengthsAVX( const Point* points, int count, float* lengths )
+{
+    int i = 0;
+    for( ; i+8<count; i+=8 )
+    {
+        __m256 x1, y1, z1, x2, y2, z2;
+        loadPoints( points+i, x1, y1, z1 );
+        loadPoints( points+i+1, x2, y2, z2 );
+
+        _mm256_storeu_ps( lengths+i, _mm256_sqrt_ps( squaredDistanceAVX( x1, y1, z1, x2, y2, z2 ) ) );
+    }
+
+    segmentLengthsScalar( points, i, count, lengths );
+}
+
+static ESO_TARGET_AVX void matchAtYAVX( const Point* probe, const int* pointAfter, const Point* mecanical, int count,
+                                        Point* matched, float* squaredDistances )
+{
+    int i = 0;
+    for( ; i+8<=count; i+=8 )
+    {
+        const Point* before[8];
+        const Point* after[8];
+        for( int k=0; k<8; ++k )
+        {
+            after[k] = mecanical + pointAfter[i+k];
+            before[k] = after[k] - 1;
+        }
+
+        __m256 bx, by, bz, ax, ay, az, px, py, pz;
+        loadPoints( before, bx, by, bz );
+        loadPoints( after, ax, ay, az );
+        loadPoints( probe+i, px, py, pz );
+
+        // point of the segment at the probe y
+        __m256 t = _mm256_div_ps( _mm256_sub_ps( py, by ), _mm256_sub_ps( ay, by ) );
+        __m256 mx = _mm256_add_ps( bx, _mm256_mul_ps( _mm256_sub_ps( ax, bx ), t ) );
+        __m256 mz = _mm256_add_ps( bz, _mm256_mul_ps( _mm256_sub_ps( az, bz ), t ) );
+
+        // or the mecanical point itself when it has the same y
+        __m256 same = _mm256_cmp_ps( ay, py, _CMP_EQ_OQ );
+        mx = _mm256_blendv_ps( mx, ax, same );
+        mz = _mm256_blendv_ps( mz, az, same );
+        __m256 my = py;
+
+        _mm256_storeu_ps( squaredDistances+i, squaredDistanceAVX( mx, my, mz, px, py, pz ) );
+
+        // back to points, the validity (4th float) is 0 = NotTested
+        __m256 w = _mm256_setzero_ps();
+        transpose( mx, my, mz, w );
+        _mm_storeu_ps( &matched[i].x, _mm256_castps256_ps128( mx ) );
+        _mm_storeu_ps( &matched[i+1].x, _mm256_castps256_ps128( my ) );
+        _mm_storeu_ps( &matched[i+2].x, _mm256_castps256_ps128( mz ) );
+        _mm_storeu_ps( &matched[i+3].x, _mm256_castps256_ps128( w ) );
+        _mm_storeu_ps( &matched[i+4].x, _mm256_extractf128_ps( mx, 1 ) );
+        _mm_storeu_ps( &matched[i+5].x, _mm256_extractf128_ps( my, 1 ) );
+        _mm_storeu_ps( &matched[i+6].x, _mm256_extractf128_ps( mz, 1 ) );
+        _mm_storeu_ps( &matched[i+7].x, _mm256_extractf128_ps( w, 1 ) );
+    }
+
+    matchAtYScalar( probe, pointAfter, mecanical, i, count, matched, squaredDistances );
+}
+
+#endif // ESO_KERNELS_AVX
+
+//  Dispatch
+/********************************************************************************/
+
+// Best instruction set compiled in and supported by this cpu
+InstructionSet supportedInstructionSet()
+{
+#ifdef ESO_KERNELS_AVX
+    if( cpuSupportsAvx() )
+        return AVX;
+#endif
+#ifdef ESO_KERNELS_SSE
+    return SSE;
+#else
+    return Scalar;
+#endif
+}
+
+static InstructionSet selectedSet = supportedInstructionSet();
+
+InstructionSet instructionSet()
+{
+    return selectedSet;
+}
+
+// Use another instruction set than the best one (to compare them), it can't be higher than the supported one
+void setInstructionSet( InstructionSet set )
+{
+    if( set > supportedInstructionSet() )
+        set = supportedInstructionSet();
+
+#ifndef ESO_KERNELS_SSE
+    // AVX can be there without SSE (32 bits build without -msse2)
+    if( set == SSE )
+        set = Scalar;
+#endif
+
+    selectedSet = set;
+}
+
+const char* instructionSetName( InstructionSet set )
+{
+    switch( set )
+    {
+    case AVX: return "AVX";
+    case SSE: return "SSE";
+    default: return "Scalar";
+    }
+}
+
+void segmentLengths( const Point* points, int count, float* lengths )
+{
+    switch( selectedSet )
+    {
+#ifdef ESO_KERNELS_AVX
+    case AVX: segmentLengthsAVX( points, count, lengths ); return;
+#endif
+#ifdef ESO_KERNELS_SSE
+    case SSE: segmentLengthsSSE( points, count, lengths ); return;
+#endif
+    default: segmentLengthsScalar( points, 0, count, lengths ); return;
+    }
+}
+
+void matchAtY( const Point* probe, const int* pointAfter, const Point* mecanical, int count,
+               Point* matched, float* squaredDistances )
+{
+    switch( selectedSet )
+    {
+#ifdef ESO_KERNELS_AVX
+    case AVX: matchAtYAVX( probe, pointAfter, mecanical, count, matched, squaredDistances ); return;
+#endif
+#ifdef ESO_KERNELS_SSE
+    case SSE: matchAtYSSE( probe, pointAfter, mecanical, count, matched, squaredDistances ); return;
+#endif
+    default: matchAtYScalar( probe, pointAfter, mecanical, 0, count, matched, squaredDistances ); return;
+    }
+}
+
+float squaredRadius( float radius )
+{
+    if( !( radius >= 0.0f ) )
+        return -1.0f;   // no distance is within a negative radius
+
+    // start with radius^2 and move by one float at a time until sqrt() crosses the radius
+    float result = radius * radius;
+    while( result > 0.0f && sqrt( result ) > radius )
+        result = nextafterf( result, 0.0f );
+    while( sqrt( nextafterf( result, HUGE_VALF ) ) <= radius && result < HUGE_VALF )
+        result = nextafterf( result, HUGE_VALF );
+
+    return result;
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef DISTANCEKERNELS_H
+#define DISTANCEKERNELS_H
+
+#include "Point.h"
+
+// Distance computations over whole arrays of points, with SSE or AVX when the cpu supports them.
+// The results are exactly the same as CurveComparer::distanceBetween2Points() and CurveComparer::pointAtY()
+// point by point, whatever instruction set is used (no fused multiply-add, same order of operations).
+// Define ESO_NO_SIMD to build only the scalar version.
+namespace DistanceKernels
+{
+    enum InstructionSet
+    {
+        Scalar = 0,
+        SSE = 1,
+        AVX = 2
+    };
+
+    InstructionSet  instructionSet();
+    InstructionSet  supportedInstructionSet();
+    void            setInstructionSet( InstructionSet set );
+    const char*     instructionSetName( InstructionSet set );
+
+    inline float squaredDistance( const Point& p1, const Point& p2 )
+    {
+        float dx = p1.x - p2.x;
+        float dy = p1.y - p2.y;
+        float dz = p1.z - p2.z;
+
+        return dx*dx + dy*dy + dz*dz;
+    }
+
+    // lengths[i] = distance between points[i] and points[i+1], for the count-1 segments
+    void    segmentLengths( const Point* points, int count, float* lengths );
+
+    // For each probe point, the point of the mecanical segment (pointAfter[i]-1, pointAfter[i]) at the same y, or the mecanical
+    // point itself if its y is the same as the probe point, and the squared distance between the two.
+    void    matchAtY( const Point* probe, const int* pointAfter, const Point* mecanical, int count,
+                      Point* matched, float* squaredDistances );
+
+    // Largest squared distance d such that sqrt(d) <= radius, comparing the squared distances to it gives
+    // exactly the same result as comparing the distances to the radius
+    float   squaredRadius( float radius );
+}
+
+#endif // DISTANCEKERNELS_H
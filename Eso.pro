@@ -4,25 +4,26 @@
 #
 #-------------------------------------------------
 
-QT       += core gui xml opengl
+QT       += core gui opengl
 
 
 TARGET      = Eso
 TEMPLATE    = app
 
 
+include(EsoCore.pri)
+
 SOURCES += main.cpp\
     GLWidget.cpp \
-    CurveComparer.cpp \
-    Mannequin.cpp \
-    MainWindow.cpp
+    CurveLod.cpp \
+    MainWindow.cpp \
+    ValidationWorker.cpp
 
 HEADERS  += \
     GLWidget.h \
-    CurveComparer.h \
-    Point.h \
-    Mannequin.h \
-    MainWindow.h
+    CurveLod.h \
+    MainWindow.h \
+    ValidationWorker.h
 
 FORMS    += \
     MainWindow.ui
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Console tool validating recorded probe curves (csv) in batch, on all the cores.
+# No QtGui nor OpenGL, see batch.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+
+TARGET      = EsoBatch
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += batch.cpp \
+    BatchValidator.cpp
+
+HEADERS  += \
+    BatchValidator.h
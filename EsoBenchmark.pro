@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Console tool timing the stages of the validation, the loaders and the mannequin loading,
+# results in json to compare the builds. See benchmark.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+
+TARGET      = EsoBenchmark
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += benchmark.cpp
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Console tool converting the csv probe curves to .probe recordings and back.
+# No QtGui nor OpenGL, see convert.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+
+TARGET      = EsoConvert
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += convert.cpp
@@ -0,0 +1,50 @@
+# Validation core, without any QtGui or OpenGL code.
+# Shared by the Eso application (Eso.pro) and the console tools (EsoBatch.pro).
+
+# The logs below ESO_LOG_COMPILED_LEVEL are not compiled (see Log.h), the release builds keep Info and above
+CONFIG(release, debug|release): DEFINES += ESO_LOG_COMPILED_LEVEL=2
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SOURCES += \
+    $$PWD/CurveComparer.cpp \
+    $$PWD/Mannequin.cpp \
+    $$PWD/MannequinRegistry.cpp \
+    $$PWD/ValidationResult.cpp \
+    $$PWD/Curve.cpp \
+    $$PWD/DistanceKernels.cpp \
+    $$PWD/IntervalStatistics.cpp \
+    $$PWD/ValidationSession.cpp \
+    $$PWD/ProbeCurveLoader.cpp \
+    $$PWD/ProbeRecording.cpp \
+    $$PWD/Log.cpp \
+    $$PWD/ValidationTrace.cpp \
+    $$PWD/SegmentTree.cpp \
+    $$PWD/RadiusSweep.cpp \
+    $$PWD/MannequinIdentifier.cpp \
+    $$PWD/LatencyHistogram.cpp \
+    $$PWD/StageMetrics.cpp \
+    $$PWD/Json.cpp
+
+HEADERS += \
+    $$PWD/CurveComparer.h \
+    $$PWD/Point.h \
+    $$PWD/Curve.h \
+    $$PWD/DistanceKernels.h \
+    $$PWD/Mannequin.h \
+    $$PWD/MannequinRegistry.h \
+    $$PWD/ValidationResult.h \
+    $$PWD/IntervalStatistics.h \
+    $$PWD/ValidationSession.h \
+    $$PWD/ProbeCurveLoader.h \
+    $$PWD/ProbeRecording.h \
+    $$PWD/Log.h \
+    $$PWD/ValidationTrace.h \
+    $$PWD/SegmentTree.h \
+    $$PWD/RadiusSweep.h \
+    $$PWD/MannequinIdentifier.h \
+    $$PWD/LatencyHistogram.h \
+    $$PWD/StageMetrics.h \
+    $$PWD/Sleeper.h \
+    $$PWD/Json.h
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Console tool simulating many trainee stations replaying csv files, to load test the live validation.
+# No QtGui nor OpenGL, see load.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+
+TARGET      = EsoLoad
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += load.cpp \
+    LoadSimulator.cpp \
+    TrackerSource.cpp \
+    TrackerPipeline.cpp
+
+HEADERS  += \
+    TrackerSource.h \
+    TrackerPipeline.h \
+    LoadSimulator.h
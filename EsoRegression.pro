@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Regression test of the validation: verdicts of the fixtures compared to their golden files
+# and validation time within budget. "make check" runs it on the fixtures of the sources, against the mannequin
+# loaded from its xml and from its cache (written to a temporary copy, so no cache in the sources is needed).
+# See regression.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+
+TARGET      = EsoRegression
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += regression.cpp
+
+check.depends   = $(TARGET)
+check.commands  = ./$(TARGET) -d $$PWD
+QMAKE_EXTRA_TARGETS += check
@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Console tool validating the points of the tracker live (udp, or a csv file replayed).
+# No QtGui nor OpenGL, see tracker.cpp for the usage.
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+
+TARGET      = EsoTracker
+CONFIG     += console
+CONFIG     -= app_bundle
+TEMPLATE    = app
+
+include(EsoCore.pri)
+
+SOURCES += tracker.cpp \
+    TrackerSource.cpp \
+    TrackerPipeline.cpp
+
+HEADERS  += \
+    TrackerSource.h \
+    TrackerPipeline.h
@@ -1,13 +1,33 @@
 #include "GLWidget.h"
 
-GLWidget::GLWidget( CurveComparer* cc, QWidget *parent ) : QGLWidget( parent )
+#include <cstddef>
+
+GLWidget::GLWidget( QWidget *parent ) : QGLWidget( parent ),
+    mannequinBuffer( QGLBuffer::VertexBuffer ), probePointsBuffer( QGLBuffer::VertexBuffer ), probeLinesBuffer( QGLBuffer::VertexBuffer ),
+    lodPointsIndexes( QGLBuffer::IndexBuffer ), lodLinesIndexes( QGLBuffer::IndexBuffer )
 {
-    this->cc = cc;
+    probeCurve = 0;
+    result = 0;
+
+    uploadedGeometryId = 0;
+    uploadedRadius = 0.0f;
+    uploadedMannequinSize = 0;
+    probeCapacity = 0;
+    uploadedProbeSize = 0;
+    probeChanged = false;
+    lodCapacity = 0;
+    uploadedLevel = -1;
+    uploadedLodSize = 0;
+
+    maxFrameRate = 0;
+    repaintPending = false;
+    lastFrameTime = 0;
+    averageFrameTime = 0;
+    framesCount = 0;
 
-    int timerInterval = 1000 / 30; // second / fps
     timer = new QTimer( this );
+    timer->setSingleShot( true );
     connect( timer, SIGNAL(timeout()), this, SLOT(timeOutSlot()));
-    timer->start( timerInterval );
 
     posX = 0.0f;
     posY = -7.0f;
@@ -16,114 +36,378 @@ GLWidget::GLWidget( CurveComparer* cc, QWidget *parent ) : QGLWidget( parent )
     rotationX = 0.0f;
 }
 
+GLWidget::~GLWidget()
+{
+    // the buffers belong to the context of the widget
+    makeCurrent();
+    mannequinBuffer.destroy();
+    probePointsBuffer.destroy();
+    probeLinesBuffer.destroy();
+    lodPointsIndexes.destroy();
+    lodLinesIndexes.destroy();
+}
+
+// Curve to draw with the result of its validation, both must stay alive until they are replaced.
+// Call it again with the same curve when points are appended to it or when it is validated again:
+// only the new points and the ones with another verdict are uploaded. The points already drawn must not change,
+// give another curve to upload everything again.
+void GLWidget::setValidation( const Curve* probeCurve, const ValidationResult* result )
+{
+    if( probeCurve != this->probeCurve )
+    {
+        uploadedProbeSize = 0;
+        probeLod.clear();
+        uploadedLevel = -1;
+    }
+
+    this->probeCurve = probeCurve;
+    this->result = result;
+    snapshot.clear();
+    probeChanged = true;
+
+    requestRepaint();
+}
+
+// Same as above with the curve and the result of a snapshot of the ValidationWorker, kept until it is replaced.
+// The snapshots of the same curve only upload the points with another verdict.
+void GLWidget::setValidation( const ValidationSnapshotPtr& snapshot )
+{
+    setValidation( snapshot->getProbeCurve(), &snapshot->getResult() );
+    this->snapshot = snapshot;
+}
+
+// Draw a new frame as soon as the frame rate allows it, the requests made before it is drawn are merged in one frame
+void GLWidget::requestRepaint()
+{
+    if( repaintPending )
+        return;
+
+    qint64 minInterval = ( maxFrameRate > 0 ) ? 1000 / maxFrameRate : 0;
+    qint64 elapsed = lastFrameClock.isValid() ? lastFrameClock.elapsed() : minInterval;
+
+    if( elapsed < minInterval )
+    {
+        repaintPending = true;
+        timer->start( minInterval - elapsed );
+    }
+    else
+        update();
+}
+
 void GLWidget::paintGL()
 {
+    lastFrameClock.start();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    if( cc->getValidity() != CurveValidity::MannequinUnavailable &&
-        cc->getValidity() != CurveValidity::NotTested )
+    if( result != 0 && probeCurve != 0 &&
+        result->getStatus() != CurveValidity::MannequinUnavailable &&
+        result->getStatus() != CurveValidity::NotTested )
     {
         glLoadIdentity();
         glTranslatef( posX, posY, posZ );
         glRotatef( rotationY, 0.0f, 1.0f, 0.0f );
         glRotatef( rotationX, 1.0f, 0.0f, 0.0f );
 
-        float radius = cc->getCurrentMannequin()->getRadius();
+        const Mannequin& mannequin = *result->getMannequin();
+        updateMannequinBuffer( mannequin );
+        updateProbeBuffers();
 
-        glBegin(GL_LINES);
-            for( int i=0; i<cc->getCurrentMannequin()->size()-1; ++i )
-            {
-                // Mecanical curve lines : YELLOW
-                glColor3f( 255.0f, 255.0f, 0.0f );
-                glVertex3d( cc->getCurrentMannequin()->at(i).x, cc->getCurrentMannequin()->at(i).y, cc->getCurrentMannequin()->at(i).z );
-                glVertex3d( cc->getCurrentMannequin()->at(i+1).x, cc->getCurrentMannequin()->at(i+1).y, cc->getCurrentMannequin()->at(i+1).z);
-
-                // Radius lines : MAGENTA
-                glColor3f( 255.0f, 0.0f, 255.0f );
-                glVertex3d( cc->getCurrentMannequin()->at(i).x + radius, cc->getCurrentMannequin()->at(i).y, cc->getCurrentMannequin()->at(i).z );
-                glVertex3d( cc->getCurrentMannequin()->at(i+1).x + radius, cc->getCurrentMannequin()->at(i+1).y, cc->getCurrentMannequin()->at(i+1).z);
-                glVertex3d( cc->getCurrentMannequin()->at(i).x - radius, cc->getCurrentMannequin()->at(i).y, cc->getCurrentMannequin()->at(i).z );
-                glVertex3d( cc->getCurrentMannequin()->at(i+1).x - radius, cc->getCurrentMannequin()->at(i+1).y, cc->getCurrentMannequin()->at(i+1).z);
-            }
+        // Mecanical curve lines : YELLOW
+        // Radius lines : MAGENTA
+        // Radius line stomach : TEAL
+        int n = uploadedMannequinSize;
+        drawBuffer( mannequinBuffer, GL_LINE_STRIP, 0, n );
+        drawBuffer( mannequinBuffer, GL_LINE_STRIP, n, n );
+        drawBuffer( mannequinBuffer, GL_LINE_STRIP, 2*n, n );
+        if( n > 0 )
+        {
+            drawBuffer( mannequinBuffer, GL_LINES, 3*n, 4 );
+            // point end of stomach
+            drawBuffer( mannequinBuffer, GL_POINTS, 3*n + 4, 1 );
+        }
+
+        // Probe curve lines and points
+        // Valid : GREEN
+        // Invalid : RED
+        // Ignored : TEAL
+        int level = probeLevel();
+        if( level == 0 )
+        {
+            if( uploadedProbeSize > 1 )
+                drawBuffer( probeLinesBuffer, GL_LINES, 0, 2 * ( uploadedProbeSize - 1 ) );
+            drawBuffer( probePointsBuffer, GL_POINTS, 0, uploadedProbeSize );
+        }
+        else
+        {
+            updateLodBuffers( level );
+            if( uploadedLodSize > 1 )
+                drawIndexes( probeLinesBuffer, lodLinesIndexes, GL_LINES, 2 * ( uploadedLodSize - 1 ) );
+            drawIndexes( probePointsBuffer, lodPointsIndexes, GL_POINTS, uploadedLodSize );
+        }
+    }
+
+    // the time to submit the frame, glFinish() would wait for the gpu but would also slow down every frame
+    lastFrameTime = lastFrameClock.nsecsElapsed();
+    averageFrameTime = ( framesCount == 0 ) ? lastFrameTime : ( averageFrameTime * 15 + lastFrameTime ) / 16;
+    framesCount++;
+}
+
+// Upload the mecanical curve, the radius lines on each side of it and the end of stomach if anything changed since the last time
+void GLWidget::updateMannequinBuffer( const Mannequin& mannequin )
+{
+    float radius = mannequin.getRadius();
+    if( mannequin.getGeometryId() == uploadedGeometryId && radius == uploadedRadius && mannequin.size() == uploadedMannequinSize )
+        return;
+
+    int n = mannequin.size();
+    const Point endOfStomach = mannequin.getEndOfStomach();
+
+    vertices.clear();
+    vertices.reserve( 3*n + 5 );
+    for( int i=0; i<n; ++i )
+        vertices.push_back( vertex( mannequin[i].x, mannequin[i].y, mannequin[i].z, 255, 255, 0 ) );
+    for( int i=0; i<n; ++i )
+        vertices.push_back( vertex( mannequin[i].x + radius, mannequin[i].y, mannequin[i].z, 255, 0, 255 ) );
+    for( int i=0; i<n; ++i )
+        vertices.push_back( vertex( mannequin[i].x - radius, mannequin[i].y, mannequin[i].z, 255, 0, 255 ) );
+
+    if( n > 0 )
+    {
+        vertices.push_back( vertex( mannequin[0].x + radius, mannequin[0].y, mannequin[0].z, 0, 100, 255 ) );
+        vertices.push_back( vertex( endOfStomach.x + radius, endOfStomach.y, endOfStomach.z, 0, 100, 255 ) );
+        vertices.push_back( vertex( mannequin[0].x - radius, mannequin[0].y, mannequin[0].z, 0, 100, 255 ) );
+        vertices.push_back( vertex( endOfStomach.x - radius, endOfStomach.y, endOfStomach.z, 0, 100, 255 ) );
+        vertices.push_back( vertex( endOfStomach.x, endOfStomach.y, endOfStomach.z, 255, 255, 255 ) );
+    }
+
+    mannequinBuffer.bind();
+    mannequinBuffer.allocate( vertices.empty() ? 0 : &vertices[0], vertices.size() * sizeof( GLVertex ) );
+    mannequinBuffer.release();
+
+    uploadedGeometryId = mannequin.getGeometryId();
+    uploadedRadius = radius;
+    uploadedMannequinSize = n;
+}
+
+// Upload the probe points appended and the ones with another verdict since the last upload
+void GLWidget::updateProbeBuffers()
+{
+    if( !probeChanged )
+        return;
+    probeChanged = false;
+
+    const Curve& probe = *probeCurve;
+    const QVector<PointValidity::Status>& verdicts = result->getVerdicts();
+    int size = qMin( probe.size(), verdicts.size() );
+
+    // first point to upload
+    int first = qMin( uploadedProbeSize, size );
+    for( int i=0; i<first; ++i )
+    {
+        if( verdicts[i] != uploadedVerdicts[i] )
+        {
+            first = i;
+            break;
+        }
+    }
+
+    // not enough room, the buffers are allocated again twice as big and everything is uploaded
+    if( size > probeCapacity )
+    {
+        probeCapacity = qMax( qMax( size, 2 * probeCapacity ), 1024 );
+
+        probePointsBuffer.bind();
+        probePointsBuffer.allocate( probeCapacity * sizeof( GLVertex ) );
+        probePointsBuffer.release();
+        probeLinesBuffer.bind();
+        probeLinesBuffer.allocate( 2 * probeCapacity * sizeof( GLVertex ) );
+        probeLinesBuffer.release();
+
+        first = 0;
+    }
+
+    if( first < size )
+    {
+        vertices.resize( size - first );
+        for( int i=first; i<size; ++i )
+            vertices[i - first] = vertex( probe[i], verdicts[i] );
+
+        probePointsBuffer.bind();
+        probePointsBuffer.write( first * sizeof( GLVertex ), &vertices[0], vertices.size() * sizeof( GLVertex ) );
+        probePointsBuffer.release();
 
-            // Radius line stomach : TEAL
-            glColor3f( 0.0f, 100.0f, 255.0f );
-            glVertex3d( cc->getCurrentMannequin()->at(0).x + radius,
-                        cc->getCurrentMannequin()->at(0).y,
-                        cc->getCurrentMannequin()->at(0).z );
-            glVertex3d( cc->getCurrentMannequin()->getEndOfStomach().x + radius,
-                        cc->getCurrentMannequin()->getEndOfStomach().y,
-                        cc->getCurrentMannequin()->getEndOfStomach().z );
-            glVertex3d( cc->getCurrentMannequin()->at(0).x - radius,
-                        cc->getCurrentMannequin()->at(0).y,
-                        cc->getCurrentMannequin()->at(0).z );
-            glVertex3d( cc->getCurrentMannequin()->getEndOfStomach().x - radius,
-                        cc->getCurrentMannequin()->getEndOfStomach().y,
-                        cc->getCurrentMannequin()->getEndOfStomach().z );
-
-            // Probe curve lines
-            // Valid : GREEN
-            // Invalid : RED
-            // Ignored : TEAL
-            for( int i=0; i<cc->getProbeCurve()->size()-1; ++i )
+        // the segment before the first point changed too, its color depends on the 2 points
+        int firstSegment = qMax( first - 1, 0 );
+        if( size - 1 > firstSegment )
+        {
+            vertices.resize( 2 * ( size - 1 - firstSegment ) );
+            for( int i=firstSegment; i<size-1; ++i )
             {
-                // RED line if at least one of the two points is invalid.
-                // GREEN line if both points are valid.
-                // TEAL otherwise.
-                if( cc->getProbePoint(i).validity == PointValidity::Ignored &&
-                    cc->getProbePoint(i+1).validity == PointValidity::Ignored )  // both points are ignored
-                    setColor( PointValidity::Ignored );
-                else if( cc->getProbePoint(i).validity == PointValidity::Invalid ||
-                         cc->getProbePoint(i+1).validity == PointValidity::Invalid )  // at least one is invalid
-                    setColor( PointValidity::Invalid );
-                else if( cc->getProbePoint(i).validity == PointValidity::Valid &&
-                         cc->getProbePoint(i+1).validity == PointValidity::Valid ) // both are valid
-                    setColor( PointValidity::Valid );
-                else
-                    setColor( PointValidity::Ignored );
-
-
-                glVertex3d( cc->getProbePoint(i).x, cc->getProbePoint(i).y, cc->getProbePoint(i).z );
-                glVertex3d( cc->getProbePoint(i+1).x, cc->getProbePoint(i+1).y, cc->getProbePoint(i+1).z);
+                PointValidity::Status color = segmentColor( verdicts[i], verdicts[i+1] );
+                vertices[2 * ( i - firstSegment )] = vertex( probe[i], color );
+                vertices[2 * ( i - firstSegment ) + 1] = vertex( probe[i+1], color );
             }
-        glEnd();
 
-        glBegin(GL_POINTS);
-            // point end of stomach
-            glColor3f( 255.0f, 255.0f, 255.0f );
-            glVertex3d( cc->getCurrentMannequin()->getEndOfStomach().x,
-                        cc->getCurrentMannequin()->getEndOfStomach().y,
-                        cc->getCurrentMannequin()->getEndOfStomach().z );
+            probeLinesBuffer.bind();
+            probeLinesBuffer.write( 2 * firstSegment * sizeof( GLVertex ), &vertices[0], vertices.size() * sizeof( GLVertex ) );
+            probeLinesBuffer.release();
+        }
+    }
+
+    uploadedVerdicts.resize( size );
+    for( int i=first; i<size; ++i )
+        uploadedVerdicts[i] = verdicts[i];
+    uploadedProbeSize = size;
+
+    probeLod.update( probe, verdicts );
+}
+
+// Level of detail of the probe curve where the points are on average about 2 pixels apart on screen.
+// The camera looks at the curve from posZ with a vertical field of view of 45 degrees (see resizeGL()).
+int GLWidget::probeLevel() const
+{
+    float distance = qAbs( posZ );
+    float unitsPerPixel = 2.0f * distance * 0.41421356f / qMax( height(), 1 );     // tan( 45 / 2 degrees )
+
+    return probeLod.levelFor( 2.0f * unitsPerPixel );
+}
+
+// Upload the indexes of the points kept by the level, only the ones that changed if it was already the level drawn
+void GLWidget::updateLodBuffers( int level )
+{
+    const QVector<int>& indexes = probeLod.indexes( level );
+    int size = indexes.size();
+    int first = ( level == uploadedLevel ) ? qMin( probeLod.dirtyFrom( level ), uploadedLodSize ) : 0;
+
+    if( size > lodCapacity )
+    {
+        lodCapacity = qMax( qMax( size, 2 * lodCapacity ), 1024 );
+
+        lodPointsIndexes.bind();
+        lodPointsIndexes.allocate( lodCapacity * sizeof( GLuint ) );
+        lodPointsIndexes.release();
+        lodLinesIndexes.bind();
+        lodLinesIndexes.allocate( 2 * lodCapacity * sizeof( GLuint ) );
+        lodLinesIndexes.release();
 
-            // draw the probe curve points
-            for( int i=0; i<cc->getProbeCurve()->size(); ++i )
+        first = 0;
+    }
+
+    if( first < size )
+    {
+        lodIndexes.resize( size - first );
+        for( int k=first; k<size; ++k )
+            lodIndexes[k - first] = indexes[k];
+
+        lodPointsIndexes.bind();
+        lodPointsIndexes.write( first * sizeof( GLuint ), &lodIndexes[0], lodIndexes.size() * sizeof( GLuint ) );
+        lodPointsIndexes.release();
+
+        // the segment from the point a to the point b starts with the first vertex of the segment a and ends with the
+        // second vertex of the segment b-1 in probeLinesBuffer: all the segments in between have the same color
+        int firstSegment = qMax( first - 1, 0 );
+        if( size - 1 > firstSegment )
+        {
+            lodIndexes.resize( 2 * ( size - 1 - firstSegment ) );
+            for( int k=firstSegment; k<size-1; ++k )
             {
-                setColor( cc->getProbePoint(i).validity );
-                glVertex3d( cc->getProbePoint(i).x, cc->getProbePoint(i).y, cc->getProbePoint(i).z );
+                lodIndexes[2 * ( k - firstSegment )] = 2 * indexes[k];
+                lodIndexes[2 * ( k - firstSegment ) + 1] = 2 * indexes[k+1] - 1;
             }
-        glEnd();
+
+            lodLinesIndexes.bind();
+            lodLinesIndexes.write( 2 * firstSegment * sizeof( GLuint ), &lodIndexes[0], lodIndexes.size() * sizeof( GLuint ) );
+            lodLinesIndexes.release();
+        }
     }
+
+    probeLod.setClean( level );
+    uploadedLevel = level;
+    uploadedLodSize = size;
 }
 
-void GLWidget::setColor( PointValidity::Status validity )
+void GLWidget::drawBuffer( QGLBuffer& buffer, GLenum mode, int first, int count )
+{
+    if( count <= 0 )
+        return;
+
+    buffer.bind();
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_COLOR_ARRAY );
+    glVertexPointer( 3, GL_FLOAT, sizeof( GLVertex ), 0 );
+    glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( GLVertex ), reinterpret_cast<const GLvoid*>( offsetof( GLVertex, r ) ) );
+
+    glDrawArrays( mode, first, count );
+
+    glDisableClientState( GL_COLOR_ARRAY );
+    glDisableClientState( GL_VERTEX_ARRAY );
+    buffer.release();
+}
+
+void GLWidget::drawIndexes( QGLBuffer& buffer, QGLBuffer& indexes, GLenum mode, int count )
+{
+    if( count <= 0 )
+        return;
+
+    buffer.bind();
+    indexes.bind();
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_COLOR_ARRAY );
+    glVertexPointer( 3, GL_FLOAT, sizeof( GLVertex ), 0 );
+    glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( GLVertex ), reinterpret_cast<const GLvoid*>( offsetof( GLVertex, r ) ) );
+
+    glDrawElements( mode, count, GL_UNSIGNED_INT, 0 );
+
+    glDisableClientState( GL_COLOR_ARRAY );
+    glDisableClientState( GL_VERTEX_ARRAY );
+    indexes.release();
+    buffer.release();
+}
+
+// RED line if at least one of the two points is invalid.
+// GREEN line if both points are valid.
+// TEAL otherwise.
+PointValidity::Status GLWidget::segmentColor( PointValidity::Status v1, PointValidity::Status v2 )
+{
+    if( v1 == PointValidity::Ignored && v2 == PointValidity::Ignored )         // both points are ignored
+        return PointValidity::Ignored;
+    else if( v1 == PointValidity::Invalid || v2 == PointValidity::Invalid )    // at least one is invalid
+        return PointValidity::Invalid;
+    else if( v1 == PointValidity::Valid && v2 == PointValidity::Valid )        // both are valid
+        return PointValidity::Valid;
+    else
+        return PointValidity::Ignored;
+}
+
+GLVertex GLWidget::vertex( const Point& p, PointValidity::Status validity )
 {
     switch( validity )
     {
     case PointValidity::Valid:
-        glColor3f( 0.0f, 255.0f, 0.0f );
-        break;
+        return vertex( p.x, p.y, p.z, 0, 255, 0 );
     case PointValidity::Ignored:
-        glColor3f( 0.0f, 255.0f, 255.0f );
-        break;
+        return vertex( p.x, p.y, p.z, 0, 255, 255 );
     case PointValidity::Invalid:
-        glColor3f( 255.0f, 0.0f, 0.0f );
-        break;
+        return vertex( p.x, p.y, p.z, 255, 0, 0 );
     case PointValidity::NotTested:
-        glColor3f( 128.0f, 128.0f, 128.0f ); // should not happen
-        break;
-    default: break; // should not happen
+    default:
+        return vertex( p.x, p.y, p.z, 128, 128, 128 ); // should not happen
     }
 }
 
+GLVertex GLWidget::vertex( float x, float y, float z, GLubyte r, GLubyte g, GLubyte b )
+{
+    GLVertex v;
+    v.x = x;
+    v.y = y;
+    v.z = z;
+    v.r = r;
+    v.g = g;
+    v.b = b;
+    v.a = 255;
+    return v;
+}
+
 void GLWidget::resizeGL(int width, int height)
 {
     if(height == 0)
@@ -147,36 +431,53 @@ void GLWidget::initializeGL()
     glPointSize( 4.0f );
     glHint( GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST );
     glEnable( GL_POINT_SMOOTH );
+
+    mannequinBuffer.create();
+    mannequinBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+    probePointsBuffer.create();
+    probePointsBuffer.setUsagePattern( QGLBuffer::DynamicDraw );
+    probeLinesBuffer.create();
+    probeLinesBuffer.setUsagePattern( QGLBuffer::DynamicDraw );
+    lodPointsIndexes.create();
+    lodPointsIndexes.setUsagePattern( QGLBuffer::DynamicDraw );
+    lodLinesIndexes.create();
+    lodLinesIndexes.setUsagePattern( QGLBuffer::DynamicDraw );
 }
 
 void GLWidget::timeOutSlot()
 {
-    updateGL();
+    repaintPending = false;
+    update();
 }
 
 void GLWidget::posXOffset( float value )
 {
     posX += value;
+    requestRepaint();
 }
 
 void GLWidget::posYOffset( float value )
 {
     posY += value;
+    requestRepaint();
 }
 
 void GLWidget::posZOffset( float value )
 {
     posZ += value;
+    requestRepaint();
 }
 
 void GLWidget::rotationXOffset( float value )
 {
     rotationX += value;
+    requestRepaint();
 }
 
 void GLWidget::rotationYOffset( float value )
 {
     rotationY += value;
+    requestRepaint();
 }
 
 void GLWidget::resetView()
@@ -186,4 +487,33 @@ void GLWidget::resetView()
     posX = 0.0f;
     posY = -7.0f;
     posZ = -50.0f;
+    requestRepaint();
+}
+
+// At most fps frames per second (0 for no limit), the changes made in between are drawn together in the next frame
+void GLWidget::setMaxFrameRate( int fps )
+{
+    maxFrameRate = qMax( fps, 0 );
+}
+
+int GLWidget::getMaxFrameRate() const
+{
+    return maxFrameRate;
+}
+
+// ns spent in the last paintGL()
+qint64 GLWidget::getLastFrameTime() const
+{
+    return lastFrameTime;
+}
+
+// ns spent in paintGL(), averaged over the last frames
+qint64 GLWidget::getAverageFrameTime() const
+{
+    return averageFrameTime;
+}
+
+int GLWidget::getFramesCount() const
+{
+    return framesCount;
 }
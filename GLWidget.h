@@ -3,30 +3,90 @@
 
 #include <QtOpenGL>
 #include <QGLWidget>
+#include <QGLBuffer>
 #include <GL/GLU.h>
 #include <QList>
+#include <vector>
 
 #include "CurveComparer.h"
+#include "CurveLod.h"
+#include "ValidationWorker.h"
+
+// Vertex of the buffers: position and color, 16 bytes
+struct GLVertex
+{
+    GLfloat x, y, z;
+    GLubyte r, g, b, a;
+};
 
 class GLWidget : public QGLWidget
 {
     Q_OBJECT
 
     private:
-        CurveComparer*  cc;
-        Curve*          probeCurve;
-        QTimer*         timer;
+        const Curve*            probeCurve;
+        const ValidationResult* result;
+        ValidationSnapshotPtr   snapshot;       // keeps the curve and result drawn alive, when they come from a snapshot
+        QTimer*                 timer;          // delays the repaints to respect maxFrameRate
+
+        // frames are only drawn when something changed (camera, curve or verdicts), at most maxFrameRate per second
+        int             maxFrameRate;       // 0 = no limit
+        bool            repaintPending;
+        QElapsedTimer   lastFrameClock;     // started at the beginning of the last frame
+        qint64          lastFrameTime;      // ns spent in the last paintGL()
+        qint64          averageFrameTime;
+        int             framesCount;
 
         float posX, posY, posZ;
         float rotationY, rotationX;
 
-        void setColor( PointValidity::Status validity );
+        // mecanical curve, radius lines and end of stomach, uploaded again only when the mannequin or its radius change
+        // (not for another copy of the same mannequin, each snapshot of the ValidationWorker has its own)
+        QGLBuffer           mannequinBuffer;
+        int                 uploadedGeometryId;
+        float               uploadedRadius;
+        int                 uploadedMannequinSize;
+
+        // probe curve: one vertex per point (GL_POINTS) and two per segment (GL_LINES, the color is the one of the segment).
+        // The buffers grow by doubling, the points appended and the verdicts changed since the last upload are the only ones written.
+        QGLBuffer           probePointsBuffer;
+        QGLBuffer           probeLinesBuffer;
+        int                 probeCapacity;          // points the buffers can hold
+        int                 uploadedProbeSize;      // points in the buffers
+        QVector<PointValidity::Status> uploadedVerdicts;
+        bool                probeChanged;
+        std::vector<GLVertex> vertices;             // reused to build what is uploaded
+
+        // levels of detail of the probe curve, the level drawn is chosen from the distance of the camera (posZ).
+        // The indexes of the points kept by the level drawn are uploaded in index buffers, the vertices are the ones above.
+        CurveLod            probeLod;
+        QGLBuffer           lodPointsIndexes;
+        QGLBuffer           lodLinesIndexes;
+        int                 lodCapacity;            // indexes of points the buffers can hold
+        int                 uploadedLevel;          // -1 when nothing is uploaded
+        int                 uploadedLodSize;
+        std::vector<GLuint> lodIndexes;             // reused to build what is uploaded
+
+        static GLVertex vertex( const Point& p, PointValidity::Status validity );
+        static GLVertex vertex( float x, float y, float z, GLubyte r, GLubyte g, GLubyte b );
+        static PointValidity::Status segmentColor( PointValidity::Status v1, PointValidity::Status v2 );
+
+        void updateMannequinBuffer( const Mannequin& mannequin );
+        void updateProbeBuffers();
+        void updateLodBuffers( int level );
+        int  probeLevel() const;
+        void drawBuffer( QGLBuffer& buffer, GLenum mode, int first, int count );
+        void drawIndexes( QGLBuffer& buffer, QGLBuffer& indexes, GLenum mode, int count );
+        void requestRepaint();
 
     public slots:
         void timeOutSlot();
 
     public:
-        explicit GLWidget( CurveComparer* cc, QWidget *parent = 0 );
+        explicit GLWidget( QWidget *parent = 0 );
+        ~GLWidget();
+        void setValidation( const Curve* probeCurve, const ValidationResult* result );
+        void setValidation( const ValidationSnapshotPtr& snapshot );
         void initializeGL();
         void resizeGL( int width, int height );
         void paintGL();
@@ -38,6 +98,12 @@ class GLWidget : public QGLWidget
         void rotationXOffset( float value );
         void rotationYOffset( float value );
         void resetView();
+
+        void    setMaxFrameRate( int fps );
+        int     getMaxFrameRate() const;
+        qint64  getLastFrameTime() const;
+        qint64  getAverageFrameTime() const;
+        int     getFramesCount() const;
 };
 
 #endif // GLWIDGET_H
@@ -0,0 +1,104 @@
+#include "IntervalStatistics.h"
+
+#include <algorithm>
+#include <functional>
+
+float medianOf( std::vector<float>& values )
+{
+    if( values.empty() )
+        return -1;
+
+    size_t index = values.size() / 2;
+    std::nth_element( values.begin(), values.begin() + index, values.end() );
+    float med = values[index];
+
+    // the value before it once sorted is the biggest of the values placed before it by nth_element
+    if( values.size() % 2 != 0 && index > 0 )
+        med = ( med + *std::max_element( values.begin(), values.begin() + index ) ) / 2;
+
+    return med;
+}
+
+RunningIntervalStatistics::RunningIntervalStatistics()
+{
+    clear();
+}
+
+void RunningIntervalStatistics::clear()
+{
+    lower.clear();
+    upper.clear();
+    min = 0.0f;
+    max = 0.0f;
+    sum = 0.0f;
+}
+
+void RunningIntervalStatistics::add( float interval )
+{
+    if( count() == 0 || interval < min )
+        min = interval;
+    if( count() == 0 || interval > max )
+        max = interval;
+    sum += interval;
+
+    if( !lower.empty() && interval < lower.front() )
+    {
+        lower.push_back( interval );
+        std::push_heap( lower.begin(), lower.end() );
+    }
+    else
+    {
+        upper.push_back( interval );
+        std::push_heap( upper.begin(), upper.end(), std::greater<float>() );
+    }
+
+    // keep the smallest half (rounded down) in lower
+    size_t half = count() / 2;
+    while( lower.size() > half )
+    {
+        std::pop_heap( lower.begin(), lower.end() );
+        upper.push_back( lower.back() );
+        lower.pop_back();
+        std::push_heap( upper.begin(), upper.end(), std::greater<float>() );
+    }
+    while( lower.size() < half )
+    {
+        std::pop_heap( upper.begin(), upper.end(), std::greater<float>() );
+        lower.push_back( upper.back() );
+        upper.pop_back();
+        std::push_heap( lower.begin(), lower.end() );
+    }
+}
+
+int RunningIntervalStatistics::count() const
+{
+    return lower.size() + upper.size();
+}
+
+// Same rule as medianOf(): upper.front() is the value at count/2 once sorted, lower.front() the one before it
+float RunningIntervalStatistics::median() const
+{
+    if( upper.empty() )
+        return -1;
+
+    if( count() % 2 != 0 && !lower.empty() )
+        return ( upper.front() + lower.front() ) / 2;
+    else
+        return upper.front();
+}
+
+IntervalStatistics RunningIntervalStatistics::statistics() const
+{
+    IntervalStatistics stats;
+
+    if( count() > 0 )
+    {
+        stats.count = count();
+        stats.min = min;
+        stats.max = max;
+        stats.avg = sum / count();
+        stats.median = median();
+    }
+
+    return stats;
+}
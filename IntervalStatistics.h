@@ -0,0 +1,44 @@
+#ifndef INTERVALSTATISTICS_H
+#define INTERVALSTATISTICS_H
+
+#include <vector>
+
+// Statistics of the distances between consecutive probe points
+struct IntervalStatistics
+{
+    int   count;
+    float min;
+    float max;
+    float avg;
+    float median;   // -1 when there is not enough data (a median of lengths can't be negative)
+
+    IntervalStatistics() : count(0), min(0.0f), max(0.0f), avg(0.0f), median(-1.0f) {}
+};
+
+// Median of the values in O(n) (the values are reordered, not sorted)
+// With an odd count, this is the average of the values at count/2 and count/2-1 once sorted, like it always was.
+float medianOf( std::vector<float>& values );
+
+// Interval statistics updated one interval at a time, for the probe curves received point by point.
+// The median is exact: the smallest half of the values is kept in a max heap and the rest in a min heap,
+// so adding a value is O(log n) and reading the statistics is O(1).
+class RunningIntervalStatistics
+{
+    private:
+        std::vector<float>  lower;
+        std::vector<float>  upper;
+        float               min;
+        float               max;
+        float               sum;
+
+    public:
+        RunningIntervalStatistics();
+
+        void    add( float interval );
+        void    clear();
+        int     count() const;
+        float   median() const;
+        IntervalStatistics statistics() const;
+};
+
+#endif // INTERVALSTATISTICS_H
@@ -0,0 +1,27 @@
+#include "Json.h"
+
+// value as a json string, between quotes. The control characters are not allowed in a json string,
+// they are all written \u00XX
+QString Json::quote( const QString& value )
+{
+    QString escaped;
+    escaped.reserve( value.size() + 2 );
+    escaped += '"';
+
+    for( int i=0; i<value.size(); ++i )
+    {
+        ushort c = value[i].unicode();
+        if( c == '\\' || c == '"' )
+        {
+            escaped += '\\';
+            escaped += value[i];
+        }
+        else if( c < 0x20 )
+            escaped += QString( "\\u%1" ).arg( c, 4, 16, QChar( '0' ) );
+        else
+            escaped += value[i];
+    }
+
+    escaped += '"';
+    return escaped;
+}
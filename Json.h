@@ -0,0 +1,12 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <QString>
+
+// Helpers of the tools that write their results as json (EsoBatch, EsoBenchmark)
+namespace Json
+{
+    QString quote( const QString& value );
+}
+
+#endif // JSON_H
@@ -0,0 +1,156 @@
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::clear()
+{
+    for( int i=0; i<BucketsCount; ++i )
+        counts[i] = 0;
+
+    count = 0;
+    sum = 0;
+    min = 0;
+    max = 0;
+}
+
+// The values under 2 * SubBuckets have a bucket each, then each power of 2 has SubBuckets buckets
+int LatencyHistogram::bucketOf( qint64 nsecs )
+{
+    if( nsecs < 2 * SubBuckets )
+        return nsecs < 0 ? 0 : int( nsecs );
+
+    // highest bit set, by halves
+    quint64 value = quint64( nsecs );
+    int exponent = 0;
+    for( int shift = 32; shift > 0; shift /= 2 )
+    {
+        if( value >> ( exponent + shift ) )
+            exponent += shift;
+    }
+
+    // the 2 bits after the highest one (SubBuckets = 4)
+    int sub = int( value >> ( exponent - 2 ) ) & ( SubBuckets - 1 );
+    return ( exponent - 1 ) * SubBuckets + sub;
+}
+
+qint64 LatencyHistogram::bucketLowerBound( int bucket )
+{
+    if( bucket < 2 * SubBuckets )
+        return bucket;
+
+    int exponent = bucket / SubBuckets + 1;
+    int sub = bucket % SubBuckets;
+    return qint64( SubBuckets + sub ) << ( exponent - 2 );
+}
+
+void LatencyHistogram::record( qint64 nsecs )
+{
+    if( nsecs < 0 )
+        nsecs = 0;
+
+    counts[bucketOf( nsecs )]++;
+
+    if( count == 0 || nsecs < min )
+        min = nsecs;
+    if( nsecs > max )
+        max = nsecs;
+
+    count++;
+    sum += nsecs;
+}
+
+void LatencyHistogram::add( const LatencyHistogram& other )
+{
+    if( other.count == 0 )
+        return;
+
+    for( int i=0; i<BucketsCount; ++i )
+        counts[i] += other.counts[i];
+
+    if( count == 0 || other.min < min )
+        min = other.min;
+    if( other.max > max )
+        max = other.max;
+
+    count += other.count;
+    sum += other.sum;
+}
+
+qint64 LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+qint64 LatencyHistogram::getSum() const
+{
+    return sum;
+}
+
+qint64 LatencyHistogram::getMin() const
+{
+    return min;
+}
+
+qint64 LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+double LatencyHistogram::getMean() const
+{
+    return count > 0 ? double( sum ) / count : 0.0;
+}
+
+// Duration under which q (0 to 1) of the values are: the upper bound of their bucket, never over the largest value.
+// 0 when the histogram is empty.
+qint64 LatencyHistogram::percentile( double q ) const
+{
+    if( count == 0 )
+        return 0;
+
+    qint64 rank = qint64( q * count + 0.5 );
+    rank = qBound( qint64( 1 ), rank, count );
+
+    qint64 seen = 0;
+    for( int i=0; i<BucketsCount; ++i )
+    {
+        seen += counts[i];
+        if( seen >= rank )
+            return qBound( min, bucketUpperBound( i ), max );
+    }
+
+    return max;
+}
+
+// Values of the buckets entirely under nsecs: exact at the upper bound of a bucket, otherwise the values of the
+// bucket of nsecs are not counted (at most 1/SubBuckets of nsecs under it)
+qint64 LatencyHistogram::countAtMost( qint64 nsecs ) const
+{
+    qint64 seen = 0;
+    for( int i=0; i<BucketsCount && bucketUpperBound( i ) <= nsecs; ++i )
+        seen += counts[i];
+
+    return seen;
+}
+
+int LatencyHistogram::bucketsCount() const
+{
+    return BucketsCount;
+}
+
+qint64 LatencyHistogram::bucketCount( int bucket ) const
+{
+    return counts[bucket];
+}
+
+// Largest value of the bucket
+qint64 LatencyHistogram::bucketUpperBound( int bucket ) const
+{
+    if( bucket + 1 >= BucketsCount )
+        return Q_INT64_C( 0x7fffffffffffffff );
+
+    return bucketLowerBound( bucket + 1 ) - 1;
+}
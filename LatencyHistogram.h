@@ -0,0 +1,48 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtGlobal>
+
+// Histogram of durations in ns, to get their percentiles without keeping them all.
+//
+// Each power of 2 is split in SubBuckets buckets of the same width, so a bucket is at most 1/SubBuckets of its values
+// wide (25%) and the percentiles are within that of the real ones, from 1 ns to the largest qint64.
+// record() is a few shifts and an increment, the histogram is not thread safe: each thread keeps its own and they are
+// merged with add() when they are read.
+class LatencyHistogram
+{
+    public:
+        static const int SubBuckets = 4;
+        static const int BucketsCount = 62 * SubBuckets;
+
+    private:
+        qint64  counts[BucketsCount];
+        qint64  count;
+        qint64  sum;
+        qint64  min;
+        qint64  max;
+
+        static int      bucketOf( qint64 nsecs );
+        static qint64   bucketLowerBound( int bucket );
+
+    public:
+        LatencyHistogram();
+
+        void    record( qint64 nsecs );
+        void    add( const LatencyHistogram& other );
+        void    clear();
+
+        qint64  getCount() const;
+        qint64  getSum() const;
+        qint64  getMin() const;
+        qint64  getMax() const;
+        double  getMean() const;
+        qint64  percentile( double q ) const;
+        qint64  countAtMost( qint64 nsecs ) const;
+
+        int     bucketsCount() const;
+        qint64  bucketCount( int bucket ) const;
+        qint64  bucketUpperBound( int bucket ) const;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,173 @@
+#include "LoadSimulator.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#ifdef Q_OS_WIN
+    #include <windows.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include "Log.h"
+#include "Sleeper.h"
+#include "TrackerPipeline.h"
+
+//  LoadStep
+/********************************************************************************/
+
+LoadStep::LoadStep()
+{
+    sessionsCount = 0;
+    seconds = 0.0;
+    cpuSeconds = 0.0;
+    receivedCount = 0;
+    droppedCount = 0;
+    validatedCount = 0;
+    maxRingOccupancy = 0;
+    attemptsCount = 0;
+    validAttemptsCount = 0;
+    invalidAttemptsCount = 0;
+}
+
+double LoadStep::cpuPerSession() const
+{
+    if( sessionsCount <= 0 || seconds <= 0.0 )
+        return 0.0;
+    return cpuSeconds / seconds / sessionsCount;
+}
+
+double LoadStep::cpuNsecsPerPoint() const
+{
+    if( validatedCount <= 0 )
+        return 0.0;
+    return cpuSeconds * 1e9 / validatedCount;
+}
+
+double LoadStep::pointsPerSecond() const
+{
+    if( seconds <= 0.0 )
+        return 0.0;
+    return validatedCount / seconds;
+}
+
+//  LoadSimulator
+/********************************************************************************/
+
+LoadSimulator::LoadSimulator( const Mannequin* mannequin, const QStringList& files ) :
+    mannequin( mannequin ), files( files )
+{
+    rate = 240.0;
+    speed = 1.0;
+    jitterMsecs = 0.0;
+    noise = 0.0f;
+    ringCapacity = 4096;
+    seed = 12345;
+}
+
+void LoadSimulator::setRate( double pointsPerSecond )
+{
+    rate = pointsPerSecond;
+}
+
+void LoadSimulator::setSpeed( double speed )
+{
+    this->speed = speed;
+}
+
+void LoadSimulator::setJitter( double msecs )
+{
+    jitterMsecs = msecs;
+}
+
+void LoadSimulator::setNoise( float standardDeviation )
+{
+    noise = standardDeviation;
+}
+
+void LoadSimulator::setRingCapacity( int capacity )
+{
+    ringCapacity = capacity;
+}
+
+void LoadSimulator::setSeed( quint32 seed )
+{
+    this->seed = seed;
+}
+
+// Run sessionsCount sessions for the given time, then stop them and wait for the end of their validations
+LoadStep LoadSimulator::run( int sessionsCount, double seconds )
+{
+    LoadStep step;
+    step.sessionsCount = sessionsCount;
+    if( files.isEmpty() || sessionsCount <= 0 )
+        return step;
+
+    QVector<TrackerPipeline*> pipelines( sessionsCount );
+    for( int i=0; i<sessionsCount; ++i )
+    {
+        CsvReplaySource* source = new CsvReplaySource( files[i % files.size()], rate, speed, true );
+        source->setJitter( jitterMsecs );
+        source->setNoise( noise );
+        source->setSeed( seed + quint32( i ) * 7919u );
+        pipelines[i] = new TrackerPipeline( source, mannequin, ringCapacity );
+    }
+
+    double cpuStart = processCpuSeconds();
+    QElapsedTimer timer;
+    timer.start();
+
+    for( int i=0; i<sessionsCount; ++i )
+        pipelines[i]->start();
+
+    qint64 end = qint64( seconds * 1000 );
+    while( timer.elapsed() < end )
+        Sleeper::msleep( qMin( end - timer.elapsed(), Q_INT64_C( 100 ) ) );
+
+    for( int i=0; i<sessionsCount; ++i )
+        pipelines[i]->stop();
+    for( int i=0; i<sessionsCount; ++i )
+        pipelines[i]->wait();
+
+    step.seconds = timer.nsecsElapsed() / 1e9;
+    step.cpuSeconds = processCpuSeconds() - cpuStart;
+
+    for( int i=0; i<sessionsCount; ++i )
+    {
+        TrackerMetrics metrics = pipelines[i]->getMetrics();
+        step.receivedCount += metrics.receivedCount;
+        step.droppedCount += metrics.droppedCount;
+        step.validatedCount += metrics.validatedCount;
+        step.maxRingOccupancy = qMax( step.maxRingOccupancy, metrics.maxRingOccupancy );
+        step.attemptsCount += metrics.attemptsCount;
+        step.validAttemptsCount += metrics.validAttemptsCount;
+        step.invalidAttemptsCount += metrics.invalidAttemptsCount;
+        step.latency.add( metrics.latency );
+
+        delete pipelines[i];
+    }
+
+    ESO_LOG_DEBUG << "Load step:" << sessionsCount << "sessions," << step.validatedCount << "points validated in" << step.seconds << "s";
+    return step;
+}
+
+// User and system time of all the threads of the process since its start
+double LoadSimulator::processCpuSeconds()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if( !GetProcessTimes( GetCurrentProcess(), &creation, &exit, &kernel, &user ) )
+        return 0.0;
+
+    // in 100 ns
+    quint64 kernelTime = ( quint64( kernel.dwHighDateTime ) << 32 ) | kernel.dwLowDateTime;
+    quint64 userTime = ( quint64( user.dwHighDateTime ) << 32 ) | user.dwLowDateTime;
+    return ( kernelTime + userTime ) / 1e7;
+#else
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+        return 0.0;
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
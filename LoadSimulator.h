@@ -0,0 +1,66 @@
+#ifndef LOADSIMULATOR_H
+#define LOADSIMULATOR_H
+
+#include <QStringList>
+
+#include "LatencyHistogram.h"
+#include "Mannequin.h"
+
+// Totals of LoadSimulator::run() for one number of sessions
+struct LoadStep
+{
+    int     sessionsCount;
+    double  seconds;                // wall clock, from the start of the sessions to the end of their validations
+    double  cpuSeconds;             // of the whole process (user + system) over the same time
+    qint64  receivedCount;
+    qint64  droppedCount;
+    qint64  validatedCount;
+    int     maxRingOccupancy;       // of the fullest ring
+    qint64  attemptsCount;          // replays finished, see TrackerMetrics
+    qint64  validAttemptsCount;
+    qint64  invalidAttemptsCount;
+    LatencyHistogram    latency;    // of all the sessions, in ns
+
+    LoadStep();
+
+    double  cpuPerSession() const;      // in cores, 1.0 = a whole core for each session
+    double  cpuNsecsPerPoint() const;
+    double  pointsPerSecond() const;
+};
+
+// Simulate many trainee stations on one validation host, to know how many of them it can serve.
+// Each session is a TrackerPipeline fed by a looped CsvReplaySource, like the live input of one station:
+// the session i replays files[i % files.size()] again and again, each pass being a new attempt.
+// The sessions all start at the same time, the jitter spreads their points (otherwise they all arrive on the same ticks).
+// Each session has its own seed, so their noise and jitter are different but the same from one run to the next.
+class LoadSimulator
+{
+    private:
+        const Mannequin*    mannequin;
+        QStringList         files;
+
+        double      rate;
+        double      speed;
+        double      jitterMsecs;
+        float       noise;
+        int         ringCapacity;
+        quint32     seed;
+
+        Q_DISABLE_COPY( LoadSimulator )
+
+    public:
+        LoadSimulator( const Mannequin* mannequin, const QStringList& files );
+
+        void    setRate( double pointsPerSecond );
+        void    setSpeed( double speed );
+        void    setJitter( double msecs );
+        void    setNoise( float standardDeviation );
+        void    setRingCapacity( int capacity );
+        void    setSeed( quint32 seed );
+
+        LoadStep    run( int sessionsCount, double seconds );
+
+        static double   processCpuSeconds();
+};
+
+#endif // LOADSIMULATOR_H
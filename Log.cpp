@@ -0,0 +1,43 @@
+#include "Log.h"
+
+volatile int Log::currentLevel = Log::Info;
+
+Log::Level Log::level()
+{
+    return static_cast<Level>( currentLevel );
+}
+
+void Log::setLevel( Level level )
+{
+    currentLevel = level;
+}
+
+// Set the level from its name (ex. "debug", from the command line), false if there is no such level
+bool Log::setLevel( const QString& name )
+{
+    QString lowerName = name.toLower();
+    for( int i=Trace; i<=Off; ++i )
+    {
+        if( lowerName == QString( levelName( static_cast<Level>( i ) ) ).toLower() )
+        {
+            setLevel( static_cast<Level>( i ) );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* Log::levelName( Level level )
+{
+    switch( level )
+    {
+        case Trace:     return "Trace";
+        case Debug:     return "Debug";
+        case Info:      return "Info";
+        case Warning:   return "Warning";
+        case Error:     return "Error";
+        case Off:       return "Off";
+        default:        return "";
+    }
+}
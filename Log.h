@@ -0,0 +1,54 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <QDebug>
+
+// Logging with levels, on top of qDebug()/qWarning()/qCritical().
+//
+//  ESO_LOG_TRACE << "Probe point:" << i;      // per point details, the validation hot path
+//  ESO_LOG_DEBUG << "Median:" << median;      // per curve details
+//  ESO_LOG_INFO  << name << "loaded.";
+//  ESO_LOG_WARNING << ...;
+//  ESO_LOG_ERROR << ...;
+//
+// A message is written only if its level is at least the runtime level (Log::setLevel(), Info by default).
+// The levels below ESO_LOG_COMPILED_LEVEL are not compiled at all: the condition is false at compile time,
+// so the message and everything streamed in it are removed by the compiler (ex. DEFINES += ESO_LOG_COMPILED_LEVEL=2
+// keeps only Info and above). Nothing is formatted for a message that is not written.
+namespace Log
+{
+    enum Level
+    {
+        Trace = 0,
+        Debug = 1,
+        Info = 2,
+        Warning = 3,
+        Error = 4,
+        Off = 5
+    };
+
+    Level       level();
+    void        setLevel( Level level );
+    bool        setLevel( const QString& name );
+    const char* levelName( Level level );
+
+    // read without a lock, it's only a hint for the threads already logging when it changes
+    extern volatile int currentLevel;
+}
+
+#ifndef ESO_LOG_COMPILED_LEVEL
+#define ESO_LOG_COMPILED_LEVEL 0
+#endif
+
+#define ESO_LOG_ENABLED( lvl ) ( (lvl) >= ESO_LOG_COMPILED_LEVEL && (lvl) >= Log::currentLevel )
+
+// a loop run once (or never) rather than an if, so the macros can be used like a stream even in an if without braces
+#define ESO_LOG_STREAM( lvl, stream ) for( bool esoLogOn = ESO_LOG_ENABLED( lvl ); esoLogOn; esoLogOn = false ) stream()
+
+#define ESO_LOG_TRACE   ESO_LOG_STREAM( Log::Trace, qDebug )
+#define ESO_LOG_DEBUG   ESO_LOG_STREAM( Log::Debug, qDebug )
+#define ESO_LOG_INFO    ESO_LOG_STREAM( Log::Info, qDebug )
+#define ESO_LOG_WARNING ESO_LOG_STREAM( Log::Warning, qWarning )
+#define ESO_LOG_ERROR   ESO_LOG_STREAM( Log::Error, qCritical )
+
+#endif // LOG_H
@@ -1,5 +1,6 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
+#include "ProbeCurveLoader.h"
 
 MainWindow::MainWindow( QWidget* parent ) : QMainWindow( parent ), ui( new Ui::MainWindow )
 {
@@ -10,19 +11,88 @@ MainWindow::MainWindow( QWidget* parent ) : QMainWindow( parent ), ui( new Ui::M
 
     // First point in all lists (mecanical and probe) should be the lowest y of the curve (starts in the stomach)
 
-    Curve* probeCurve = loadProbeCurve( "zigzag_fast.csv" );
+    probeCurve = QSharedPointer<const Curve>( loadProbeCurve( "zigzag_fast.csv" ) );
 
-    cc = new CurveComparer();
-    cc->addMannequin( new Mannequin( "bob2.mannequin" ) );
+    mannequins = new MannequinRegistry();
+    mannequins->addMannequin( new Mannequin( "bob2.mannequin" ) );
 
-    qDebug() << curveValidityString( cc->isCurveValid( "BOB002", probeCurve ) );
-
-    glView = new GLWidget( cc, this );
+    glView = new GLWidget( this );
     glView->setGeometry( 10, 10, 800, 600 );
 
+    // the validations are done on the worker thread, the window only shows their results
+    worker = new ValidationWorker();
+    lastValidationJobId = 0;
+    worker->setTraceCapacity( 64 );
+    connect( worker, SIGNAL(validated(ValidationSnapshotPtr)), this, SLOT(showValidation(ValidationSnapshotPtr)) );
+    worker->start();
+
+    validate();
+
     setFixedSize( 1050, 620 );
 }
 
+// Validate the probe curve again, with the settings of the mannequin as they are now.
+// It returns right away, the result is shown by showValidation() unless validate() is called again before
+void MainWindow::validate()
+{
+    if( !mannequins->contains( "BOB002" ) )
+    {
+        worker->cancel();
+        ESO_LOG_INFO << curveValidityString( CurveValidity::MannequinUnavailable );
+        return;
+    }
+
+    lastValidationJobId = worker->submit( probeCurve, *mannequins->mannequin( "BOB002" ) );
+}
+
+// Result of the last job of the worker: the last validate(), or the radius sweep or the identification asked since
+void MainWindow::showValidation( ValidationSnapshotPtr snapshot )
+{
+    // another job was submitted since this one was given
+    if( !worker->isLastJob( snapshot->getJobId() ) )
+        return;
+
+    if( snapshot->getJob() == ValidationSnapshot::SweepRadius )
+    {
+        const RadiusSweep& sweep = snapshot->getRadiusSweep();
+        float radius = sweep.smallestValidRadius();
+        ESO_LOG_INFO << "Smallest valid radius:" << radius << "without invalid points:" << sweep.smallestRadiusWithoutInvalidPoints();
+        if( radius >= 0.0f && mannequins->contains( "BOB002" ) )
+        {
+            mannequins->mannequin( "BOB002" )->setRadius( radius );
+            validate();
+        }
+        else
+            showLastValidation();
+        return;
+    }
+
+    if( snapshot->getJob() == ValidationSnapshot::Identify )
+    {
+        const MannequinMatch& match = snapshot->getMatch();
+        ESO_LOG_INFO << "Best match:" << match.mannequinId << "rms distance:" << match.rmsDistance;
+        showLastValidation();
+        return;
+    }
+
+    this->snapshot = snapshot;
+    const ValidationResult& result = snapshot->getResult();
+    ESO_LOG_INFO << curveValidityString( result.getStatus() );
+    ESO_LOG_DEBUG << "Validated in" << snapshot->getValidateNsecs() << "ns";
+
+    // the details of the points are only written when the curve is not valid
+    if( result.getStatus() != CurveValidity::Valid )
+        result.getTrace().dump();
+    glView->setValidation( snapshot );
+}
+
+// The job submitted after the last validate() replaced it if it wasn't started yet, validate again in that case
+void MainWindow::showLastValidation()
+{
+    if( snapshot.isNull() || snapshot->getJobId() != lastValidationJobId )
+        validate();
+}
+
 QString MainWindow::curveValidityString( CurveValidity::Status validity ) const
 {
     switch( validity )
@@ -96,13 +166,38 @@ void MainWindow::keyPressEvent( QKeyEvent* keyEvent )
             break;
 
         case Qt::Key_Asterisk:  //this is for testing
-            cc->getCurrentMannequin()->setRadius( cc->getCurrentMannequin()->getRadius() + 0.1f );
-            qDebug() << curveValidityString( cc->isCurveValid( "BOB002", cc->getProbeCurve() ) );
+            if( mannequins->contains( "BOB002" ) )
+            {
+                mannequins->mannequin( "BOB002" )->setRadius( mannequins->mannequin( "BOB002" )->getRadius() + 0.1f );
+                validate();
+            }
             break;
 
         case Qt::Key_Slash:     //this is for testing
-            cc->getCurrentMannequin()->setRadius( cc->getCurrentMannequin()->getRadius() - 0.1f );
-            qDebug() << curveValidityString( cc->isCurveValid( "BOB002", cc->getProbeCurve() ) );
+            if( mannequins->contains( "BOB002" ) )
+            {
+                mannequins->mannequin( "BOB002" )->setRadius( mannequins->mannequin( "BOB002" )->getRadius() - 0.1f );
+                validate();
+            }
+            break;
+
+        case Qt::Key_M:         //this is for testing, switch between the matching methods to compare them
+            if( mannequins->contains( "BOB002" ) )
+            {
+                Mannequin* mannequin = mannequins->mannequin( "BOB002" );
+                mannequin->setMatching( mannequin->getMatching() == Matching::SameHeight ? Matching::ClosestPoint : Matching::SameHeight );
+                ESO_LOG_INFO << "Matching:" << Matching::name( mannequin->getMatching() );
+                validate();
+            }
+            break;
+
+        case Qt::Key_R:         //this is for testing, set the smallest radius at which the curve is valid (on the worker, see showValidation())
+            if( mannequins->contains( "BOB002" ) )
+                worker->submitRadiusSweep( probeCurve, *mannequins->mannequin( "BOB002" ) );
+            break;
+
+        case Qt::Key_I:         //this is for testing, find the mannequin closest to the probe curve (on the worker, see showValidation())
+            worker->submitIdentification( probeCurve, *mannequins );
             break;
 
         case Qt::Key_1:
@@ -128,40 +223,17 @@ void MainWindow::keyPressEvent( QKeyEvent* keyEvent )
 }
 
 // This method load the points of the probe's curve from a csv file.
-// The data is collected from a metrics csv file, parsed to be easier to read
 // mostly intended for test purpose only since the probe curve points aquisition will probably not come from a file
 Curve* MainWindow::loadProbeCurve( const QString& filename )
 {
-    QFile file( filename );
-    Curve* probeCurve = new Curve();
-
-    if( file.open( QIODevice::ReadOnly | QIODevice::Text ) )
-    {
-        while( !file.atEnd() )
-        {
-            QString line = file.readLine();
-            QStringList pos = line.split(";");
-            if( pos.size() == 3 )
-            {
-                float x = pos[0].toFloat();
-                float y = pos[1].toFloat();
-                float z = pos[2].toFloat();
-                probeCurve->append( Point(x, y, z) );
-            }
-            else
-                qDebug() << "File " + filename + " doesn't have the right format.";
-        }
-        file.close();
-    }
-
-    qDebug() << filename << "loaded. It contains " << probeCurve->size() << " points.";
-
-    return probeCurve;
+    return ProbeCurveLoader::load( filename );
 }
 
 MainWindow::~MainWindow()
 {
+    // waits for the job running, it doesn't use the mannequins of the window
+    delete worker;
     delete glView;
     delete ui;
-    delete cc;
+    delete mannequins;
 }
@@ -5,6 +5,7 @@
 
 #include "CurveComparer.h"
 #include "GLWidget.h"
+#include "ValidationWorker.h"
 
 namespace Ui
 {
@@ -17,12 +18,21 @@ class MainWindow : public QMainWindow
 
     private:
         Ui::MainWindow* ui;
-        GLWidget*       glView;
-        CurveComparer*  cc;
-        QLabel*         label;
+        GLWidget*           glView;
+        MannequinRegistry*  mannequins;
+        QSharedPointer<const Curve> probeCurve;     // never modified once loaded, shared with the snapshots
+        ValidationWorker*   worker;
+        ValidationSnapshotPtr snapshot;             // validation shown
+        int                 lastValidationJobId;    // of the last validate()
+        QLabel*             label;
 
         Curve*      loadProbeCurve( const QString& filename );
+        void        validate();
+        void        showLastValidation();
         QString     curveValidityString( CurveValidity::Status validity ) const;
+
+    private slots:
+        void        showValidation( ValidationSnapshotPtr snapshot );
     
     public:
         explicit MainWindow( QWidget *parent = 0 );
@@ -1,72 +1,488 @@
 #include "Mannequin.h"
+#include "DistanceKernels.h"
+#include "Log.h"
+#include "StageMetrics.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <QAtomicInt>
+#include <QFile>
+#include <QFileInfo>
 
 Mannequin::Mannequin( const QString& filename )
 {
     loadMannequin( filename );
     loadSettings();
-    qDebug() << name << "loaded. It contains " << size() << " points.";
+    ESO_LOG_INFO << name << "loaded. It contains " << size() << " points.";
+
+    if( !isMonotonicY() )
+        ESO_LOG_WARNING << name << "mecanical curve is not monotonic in y, it goes down in" << folds.size() << "y range(s).";
 }
 
 void Mannequin::loadSettings()
 {
     // these settings should be loaded from a file at the same time as the mannequin file
-    radius = 2.0f;
+    setRadius( 2.0f );
     curveLengthThreshold = 0.15f;
     maxY = 23.0f;
     maxIntervalMedian = 2.0f;
+    matching = Matching::SameHeight;
 
     endOfStomach = Point( 2.1306f, -17.9064f, -2.1112f );  // probe1.csv
     //endOfStomach = Point( 1.9190f, -18.2423f, -1.9777f );  // probe2.csv
     //endOfStomach = Point( 2.1231f, -17.7418f, -2.1759f );  // probe3.csv
 }
 
+// Binary sidecar of a .mannequin file, compiled the first time the xml is read and used instead of it
+// as long as it is not older than the .mannequin file. Define ESO_NO_MANNEQUIN_CACHE to always read the xml.
+//
+// header, then the name in utf-8 (padded to 4 bytes), then x, y, z of each point as floats.
+// Everything is 4 bytes aligned so the points are read directly from the mapped file.
+// The file is in the byte order of the machine, a cache from another byte order has the wrong magic and is ignored.
+struct MannequinCacheHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 headerSize;
+    quint32 nameSize;
+    quint32 pointsCount;
+    quint32 checksum;       // of everything after the header
+    qint64  sourceSize;     // size of the .mannequin file it was compiled from
+};
+
+static const quint32 MannequinCacheMagic = 0x4d4f5345;    // "ESOM"
+static const quint32 MannequinCacheVersion = 1;
+
+static int paddedSize( int size )
+{
+    return ( size + 3 ) & ~3;
+}
+
+// FNV-1a, enough to find a cache that was truncated or modified
+static quint32 cacheChecksum( const uchar* data, qint64 size )
+{
+    quint32 hash = 2166136261u;
+    for( qint64 i=0; i<size; ++i )
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+QString Mannequin::cacheFilename( const QString& filename )
+{
+    return filename + ".cache";
+}
+
 void Mannequin::loadMannequin( const QString& filename )
 {
+    StageTimer timer( Stage::MannequinLoad, 0 );
+
     // remove all elements before adding new ones
     this->clear();
 
-    QDomDocument doc( "mannequin" );
-    QFile file( filename );
+#ifndef ESO_NO_MANNEQUIN_CACHE
+    QFileInfo source( filename );
+    QFileInfo cache( cacheFilename( filename ) );
 
-    if( !file.open( QIODevice::ReadOnly ) )
+    if( cache.exists() && cache.lastModified() >= source.lastModified() && loadBinaryCache( filename ) )
+    {
+        updateDerivedData();
+        timer.setItems( size() );
         return;
+    }
+#endif
 
-    if( !doc.setContent( &file ) )
+    if( !loadXml( filename ) )
     {
-        file.close();
+        this->clear();
+        updateDerivedData();
         return;
     }
-    file.close();
+    updateDerivedData();
+    timer.setItems( size() );
+
+#ifndef ESO_NO_MANNEQUIN_CACHE
+    // the cache is only there to load faster, the mannequin is fine without it (ex. read only directory)
+    if( size() > 0 && !saveBinaryCache( filename ) )
+        ESO_LOG_DEBUG << "Can't write the cache of" << filename;
+#endif
+}
+
+// Read only the Mannequin element and the points of the mechanical TEECurve, the rest of the file is skipped
+bool Mannequin::loadXml( const QString& filename )
+{
+    QFile file( filename );
 
-    QDomElement docElem = doc.documentElement();
-    QDomNode n = docElem.firstChild();
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
 
-    while( !n.isNull() )
-    {
-        QDomElement e = n.toElement(); // try to convert the node to an element.
+    QXmlStreamReader xml( &file );
 
-        if( e.tagName() == "Mannequin" )
+    if( xml.readNextStartElement() )   // VimedixMannequinFile
+    {
+        while( xml.readNextStartElement() )
         {
-            this->name = e.attribute("mannequinID");
+            if( xml.name() == "Mannequin" )
+            {
+                this->name = xml.attributes().value( "mannequinID" ).toString();
+                xml.skipCurrentElement();
+            }
+            else if( xml.name() == "TEECurve" )
+                readCurve( xml );
+            else
+                xml.skipCurrentElement();
         }
+    }
+    file.close();
 
-        if( e.tagName() == "TEECurve" )
+    if( xml.hasError() )
+    {
+        ESO_LOG_ERROR << filename << "line" << xml.lineNumber() << ":" << xml.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+// The CurveInfo comes first in a TEECurve, the curves that are not mechanical are skipped once it is read
+void Mannequin::readCurve( QXmlStreamReader& xml )
+{
+    bool mechanical = false;
+
+    while( xml.readNextStartElement() )
+    {
+        if( xml.name() == "CurveInfo" )
         {
-            if( n.firstChildElement( "CurveInfo" ).attribute("CurveType") == "Mechanical" )
+            mechanical = xml.attributes().value( "CurveType" ) == "Mechanical";
+            xml.skipCurrentElement();
+
+            if( !mechanical )
             {
-                QDomNodeList list = n.childNodes();
-                for( int i=1; i<list.size(); ++i ) // start at 1 to skip the CurveInfo node
-                {
-                    Point p( list.at(i).toElement().attribute("PositionX").toFloat(),
-                             list.at(i).toElement().attribute("PositionY").toFloat(),
-                             list.at(i).toElement().attribute("PositionZ").toFloat() );
-                    this->append(p);
-                }
+                xml.skipCurrentElement();   // the rest of the TEECurve
+                return;
             }
         }
+        else if( xml.name() == "CurvePoint" && mechanical )
+        {
+            QXmlStreamAttributes attributes = xml.attributes();
+            this->append( Point( attributes.value( "PositionX" ).toString().toFloat(),
+                                 attributes.value( "PositionY" ).toString().toFloat(),
+                                 attributes.value( "PositionZ" ).toString().toFloat() ) );
+            xml.skipCurrentElement();
+        }
+        else
+            xml.skipCurrentElement();
+    }
+}
+
+// Load the name and the points from the cache of filename, false if it doesn't match filename or is damaged
+bool Mannequin::loadBinaryCache( const QString& filename )
+{
+    QFile file( cacheFilename( filename ) );
+
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    qint64 fileSize = file.size();
+    if( fileSize < (qint64)sizeof( MannequinCacheHeader ) )
+        return false;
+
+    // mapped when possible, read otherwise
+    QByteArray content;
+    const uchar* data = file.map( 0, fileSize );
+    if( !data )
+    {
+        content = file.readAll();
+        if( content.size() != fileSize )
+            return false;
+        data = reinterpret_cast<const uchar*>( content.constData() );
+    }
+
+    bool loaded = false;
+    const MannequinCacheHeader* header = reinterpret_cast<const MannequinCacheHeader*>( data );
+
+    if( header->magic == MannequinCacheMagic && header->version == MannequinCacheVersion
+        && header->headerSize == sizeof( MannequinCacheHeader )
+        && header->sourceSize == QFileInfo( filename ).size()
+        && header->nameSize < (quint32)fileSize && header->pointsCount < (quint32)fileSize
+        && fileSize == (qint64)sizeof( MannequinCacheHeader ) + paddedSize( header->nameSize ) + header->pointsCount * 3 * (qint64)sizeof( float )
+        && header->checksum == cacheChecksum( data + sizeof( MannequinCacheHeader ), fileSize - sizeof( MannequinCacheHeader ) ) )
+    {
+        const char* nameData = reinterpret_cast<const char*>( data + sizeof( MannequinCacheHeader ) );
+        const float* points = reinterpret_cast<const float*>( data + sizeof( MannequinCacheHeader ) + paddedSize( header->nameSize ) );
+
+        this->name = QString::fromUtf8( nameData, header->nameSize );
+        this->reserve( header->pointsCount );
+        for( quint32 i=0; i<header->pointsCount; ++i )
+            this->append( Point( points[3*i], points[3*i+1], points[3*i+2] ) );
+
+        loaded = true;
+    }
+
+    if( content.isEmpty() )
+        file.unmap( const_cast<uchar*>( data ) );
+    file.close();
+
+    return loaded;
+}
+
+// Write the cache of filename with the current name and points
+bool Mannequin::saveBinaryCache( const QString& filename ) const
+{
+    QByteArray utf8Name = name.toUtf8();
+
+    QByteArray payload;
+    payload.append( utf8Name );
+    payload.append( QByteArray( paddedSize( utf8Name.size() ) - utf8Name.size(), '\0' ) );
+    for( int i=0; i<size(); ++i )
+    {
+        float coordinates[3] = { at(i).x, at(i).y, at(i).z };
+        payload.append( reinterpret_cast<const char*>( coordinates ), sizeof( coordinates ) );
+    }
+
+    MannequinCacheHeader header;
+    header.magic = MannequinCacheMagic;
+    header.version = MannequinCacheVersion;
+    header.headerSize = sizeof( MannequinCacheHeader );
+    header.nameSize = utf8Name.size();
+    header.pointsCount = size();
+    header.checksum = cacheChecksum( reinterpret_cast<const uchar*>( payload.constData() ), payload.size() );
+    header.sourceSize = QFileInfo( filename ).size();
+
+    // written next to it then renamed, so a cache is never read half written
+    QString cache = cacheFilename( filename );
+    QFile file( cache + ".tmp" );
+
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    bool written = file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) ) == (qint64)sizeof( header )
+                && file.write( payload ) == payload.size();
+    file.close();
 
-        n = n.nextSibling();
+    if( !written )
+    {
+        file.remove();
+        return false;
     }
+
+    QFile::remove( cache );
+    return file.rename( cache );
+}
+
+// Compute everything that depends only on the points of the mecanical curve once, instead of at each validation.
+// It must be called again if the points are modified.
+void Mannequin::updateDerivedData()
+{
+    static QAtomicInt lastGeometryId;
+
+    updateYIndex();
+    updateGeometry();
+    geometryId = lastGeometryId.fetchAndAddRelaxed( 1 ) + 1;
+}
+
+// Everything that depends only on the settings, called by the setters
+void Mannequin::updateSettingsData()
+{
+    squaredRadius = DistanceKernels::squaredRadius( radius );
+}
+
+// Build the y index of the mecanical curve
+void Mannequin::updateYIndex()
+{
+    maxYUpTo.resize( size() );
+    folds.clear();
+
+    for( int i=0; i<size(); ++i )
+    {
+        // the search starts at the point 1 (like CurveComparer always did), the point 0 is only kept for the size
+        if( i <= 1 || at(i).y > maxYUpTo[i-1] )
+            maxYUpTo[i] = at(i).y;
+        else
+            maxYUpTo[i] = maxYUpTo[i-1];
+
+        // the curve goes down, the heights between these 2 points are crossed more than once
+        if( i > 0 && at(i).y < at(i-1).y )
+            folds.append( QPair<float, float>( at(i).y, at(i-1).y ) );
+    }
+
+    // sort the folds by their lowest y and merge the ones that overlap
+    qSort( folds );
+
+    QList< QPair<float, float> > merged;
+    for( int i=0; i<folds.size(); ++i )
+    {
+        if( !merged.isEmpty() && folds[i].first <= merged.last().second )
+            merged.last().second = qMax( merged.last().second, folds[i].second );
+        else
+            merged.append( folds[i] );
+    }
+    folds = merged;
+}
+
+// Arc lengths, segment table and bounds of the mecanical curve
+void Mannequin::updateGeometry()
+{
+    int segmentsCount = qMax( size() - 1, 0 );
+    segmentLengths.resize( segmentsCount );
+    segmentDirections.resize( segmentsCount );
+    arcLengths.resize( size() );
+
+    if( segmentsCount > 0 )
+        DistanceKernels::segmentLengths( constData(), size(), segmentLengths.data() );
+
+    // added in order, so getLength() is exactly the sum CurveComparer always did
+    float length = 0.0f;
+    for( int i=0; i<size(); ++i )
+    {
+        arcLengths[i] = length;
+        if( i < segmentsCount )
+        {
+            float segmentLength = segmentLengths[i];
+            if( segmentLength > 0.0f )
+                segmentDirections[i] = Point( ( at(i+1).x - at(i).x ) / segmentLength,
+                                              ( at(i+1).y - at(i).y ) / segmentLength,
+                                              ( at(i+1).z - at(i).z ) / segmentLength );
+            else
+                segmentDirections[i] = Point( 0.0f, 0.0f, 0.0f );
+
+            length += segmentLength;
+        }
+    }
+
+    boundsMin = Point( FLT_MAX, FLT_MAX, FLT_MAX );
+    boundsMax = Point( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+    for( int i=0; i<size(); ++i )
+    {
+        boundsMin = Point( qMin( boundsMin.x, at(i).x ), qMin( boundsMin.y, at(i).y ), qMin( boundsMin.z, at(i).z ) );
+        boundsMax = Point( qMax( boundsMax.x, at(i).x ), qMax( boundsMax.y, at(i).y ), qMax( boundsMax.z, at(i).z ) );
+    }
+    if( isEmpty() )
+    {
+        boundsMin = Point( 0.0f, 0.0f, 0.0f );
+        boundsMax = Point( 0.0f, 0.0f, 0.0f );
+    }
+    lowestY = boundsMin.y;
+    highestY = boundsMax.y;
+
+    segmentTree.build( *this );
+}
+
+// Return the index of the first mecanical point (starting at 1) with mecanicalPoint.y >= y,
+// or size() if the whole curve is below y. O(log n) since maxYUpTo is sorted.
+// When the curve is not monotonic, this is the first time the curve reaches y (see isAmbiguousY()).
+int Mannequin::findPointAfter( float y ) const
+{
+    if( size() < 2 )
+        return size();
+
+    return std::lower_bound( maxYUpTo.begin() + 1, maxYUpTo.end(), y ) - maxYUpTo.begin();
+}
+
+float Mannequin::getMaxYUpTo( int i ) const
+{
+    return maxYUpTo[i];
+}
+
+bool Mannequin::isMonotonicY() const
+{
+    return folds.isEmpty();
+}
+
+// True if the mecanical curve can be at the height y in more than one place,
+// the equivalent point found by findPointAfter() is then only the first one
+bool Mannequin::isAmbiguousY( float y ) const
+{
+    if( folds.isEmpty() )
+        return false;
+
+    // last fold starting below y
+    int low = 0;
+    int high = folds.size();
+    while( low < high )
+    {
+        int middle = ( low + high ) / 2;
+        if( folds[middle].first <= y )
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low > 0 && y <= folds[low-1].second;
+}
+
+// Length of the mecanical curve from the point 0 to the point i
+float Mannequin::getArcLength( int i ) const
+{
+    return arcLengths[i];
+}
+
+// Length of the whole mecanical curve
+float Mannequin::getLength() const
+{
+    return arcLengths.isEmpty() ? 0.0f : arcLengths.last();
+}
+
+// Length of the mecanical curve from the point startIndex to the point endIndex, in O(1)
+float Mannequin::getLengthBetween( int startIndex, int endIndex ) const
+{
+    return arcLengths[endIndex] - arcLengths[startIndex];
+}
+
+float Mannequin::getSegmentLength( int i ) const
+{
+    return segmentLengths[i];
+}
+
+Point Mannequin::getSegmentDirection( int i ) const
+{
+    return segmentDirections[i];
+}
+
+// Two mannequins with the same id have the same mecanical curve: one is a copy of the other
+int Mannequin::getGeometryId() const
+{
+    return geometryId;
+}
+
+float Mannequin::getLowestY() const
+{
+    return lowestY;
+}
+
+float Mannequin::getHighestY() const
+{
+    return highestY;
+}
+
+Point Mannequin::getBoundsMin() const
+{
+    return boundsMin;
+}
+
+Point Mannequin::getBoundsMax() const
+{
+    return boundsMax;
+}
+
+// Point of the mecanical curve closest to p in 3d, in O(log n). segment is set to the segment (i, i+1) it is on,
+// -1 if the curve has less than 2 points (the point returned is then p itself).
+Point Mannequin::findClosestPoint( const Point& p, int* segment, float* squaredDistance ) const
+{
+    Point closest = p;
+    float distance = 0.0f;
+    int found = segmentTree.findClosest( p, closest, distance );
+
+    if( found == -1 )
+        distance = 0.0f;
+    if( segment )
+        *segment = found;
+    if( squaredDistance )
+        *squaredDistance = distance;
+
+    return closest;
 }
 
 float Mannequin::getMaxIntervalMedian() const
@@ -85,6 +501,8 @@ void Mannequin::setRadius( float value )
         radius = 0.0f;
     else
         radius = value;
+
+    updateSettingsData();
 }
 
 float Mannequin::getRadius() const
@@ -92,6 +510,11 @@ float Mannequin::getRadius() const
     return radius;
 }
 
+float Mannequin::getSquaredRadius() const
+{
+    return squaredRadius;
+}
+
 Point Mannequin::getEndOfStomach() const
 {
     return endOfStomach;
@@ -106,3 +529,36 @@ float Mannequin::getMaxY() const
 {
     return maxY;
 }
+
+void Mannequin::setMatching( Matching::Method method )
+{
+    matching = method;
+}
+
+Matching::Method Mannequin::getMatching() const
+{
+    return matching;
+}
+
+// Name of the method, as given to the tools (ex. EsoBatch -e ClosestPoint)
+const char* Matching::name( Method method )
+{
+    switch( method )
+    {
+        case SameHeight:    return "SameHeight";
+        case ClosestPoint:  return "ClosestPoint";
+        default:            return "";
+    }
+}
+
+bool Matching::fromName( const QString& name, Method& method )
+{
+    if( name.compare( "SameHeight", Qt::CaseInsensitive ) == 0 )
+        method = SameHeight;
+    else if( name.compare( "ClosestPoint", Qt::CaseInsensitive ) == 0 )
+        method = ClosestPoint;
+    else
+        return false;
+
+    return true;
+}
@@ -1,38 +1,98 @@
 #ifndef MANNEQUIN_H
 #define MANNEQUIN_H
 
-#include <QtXml>
+#include <QXmlStreamReader>
 #include <QString>
 #include <QList>
+#include <QVector>
+#include <QPair>
 
-#include "Point.h"
+#include "Curve.h"
+#include "SegmentTree.h"
 
-typedef QList<Point> Curve;
+// How a probe point is matched with a point of the mecanical curve, to compare their distance to the radius
+namespace Matching
+{
+    enum Method
+    {
+        SameHeight = 0,     // the point of the curve at the same y (the first one if the curve reaches it more than once)
+        ClosestPoint = 1    // the point of the curve closest in 3d, found in the segment tree of the mannequin
+    };
+
+    const char* name( Method method );
+    bool        fromName( const QString& name, Method& method );
+}
 
 class Mannequin : public Curve
 {
     private:
         QString name;               // name of the mannequin (ex. BOB001, BOB002, ARN001, CAT001, ...)
         float radius;               // a probe point is valid if it is within this radius of it's equivalent mecanical point
+        float squaredRadius;        // largest squared distance within the radius, see DistanceKernels::squaredRadius()
         Point endOfStomach;         // point when the probe is at the end of the stomach
         float curveLengthThreshold; // threshold of validity for the probe curve compared to the mecanical curve (ex. 0.1 = 10%)
         float maxY;                 // max value of y after which probe points won't be tested anymore (low y is closer to the stomach)
         float maxIntervalMedian;    // max value that the median of the distance between each probe points can be for the curve to be valid
+        Matching::Method matching;  // how the probe points are matched with the mecanical curve
+
+        // y index of the mecanical curve, to find the segment at a given height without going through all the points
+        QVector<float> maxYUpTo;                // highest y of the curve from the point 1 up to each point, never decreases
+        QList< QPair<float, float> > folds;     // y ranges (min, max) where the curve goes down, sorted and merged
+
+        // geometry of the mecanical curve, it never changes once the mannequin is loaded
+        QVector<float> arcLengths;              // length of the curve from the point 0 to each point
+        QVector<float> segmentLengths;          // length of the segment (i, i+1)
+        QVector<Point> segmentDirections;       // unit vector from the point i to the point i+1 (0, 0, 0 for an empty segment)
+        float lowestY;
+        float highestY;
+        Point boundsMin;                        // bounding box of the curve
+        Point boundsMax;
+        SegmentTree segmentTree;                // to find the point of the curve closest to a probe point
+        int geometryId;                         // new at each updateDerivedData(), kept by the copies (ex. the ones of the snapshots)
 
         void loadSettings();
+        void updateSettingsData();
+        void updateYIndex();
+        void updateGeometry();
+        bool loadXml( const QString& filename );
+        void readCurve( QXmlStreamReader& xml );
+        bool loadBinaryCache( const QString& filename );
+        bool saveBinaryCache( const QString& filename ) const;
 
     public:
         Mannequin( const QString& filename );
 
         void loadMannequin( const QString& filename );
+        static QString cacheFilename( const QString& filename );
+        void updateDerivedData();
+
+        int   findPointAfter( float y ) const;
+        float getMaxYUpTo( int i ) const;
+        bool  isMonotonicY() const;
+        bool  isAmbiguousY( float y ) const;
+
+        float getArcLength( int i ) const;
+        float getLength() const;
+        float getLengthBetween( int startIndex, int endIndex ) const;
+        float getSegmentLength( int i ) const;
+        Point getSegmentDirection( int i ) const;
+        float getLowestY() const;
+        float getHighestY() const;
+        Point getBoundsMin() const;
+        Point getBoundsMax() const;
+        Point findClosestPoint( const Point& p, int* segment = 0, float* squaredDistance = 0 ) const;
+        int   getGeometryId() const;
 
         float getMaxIntervalMedian() const;
         QString getName() const;
         void setRadius( float value );
         float getRadius() const;
+        float getSquaredRadius() const;
         Point getEndOfStomach() const;
         float getCurveLengthThreshold() const;
         float getMaxY() const;
+        void  setMatching( Matching::Method method );
+        Matching::Method getMatching() const;
 };
 
 #endif // MANNEQUIN_H
@@ -0,0 +1,230 @@
+#include "MannequinIdentifier.h"
+
+#include <QMutexLocker>
+#include <cmath>
+
+#include "Log.h"
+
+MannequinMatch::MannequinMatch()
+{
+    rmsDistance = -1.0f;
+    testedPointsCount = 0;
+    candidatesCount = 0;
+    filteredCount = 0;
+    abandonedCount = 0;
+}
+
+//  IdentifierWorker
+/********************************************************************************/
+
+IdentifierWorker::IdentifierWorker( MannequinIdentifier* identifier ) : identifier( identifier )
+{
+}
+
+void IdentifierWorker::run()
+{
+    identifier->scoreCandidates();
+}
+
+//  MannequinIdentifier
+/********************************************************************************/
+
+bool MannequinIdentifier::Candidate::operator<( const Candidate& other ) const
+{
+    return lowerBound < other.lowerBound;
+}
+
+MannequinIdentifier::MannequinIdentifier( const MannequinRegistry* mannequins ) : mannequins( mannequins )
+{
+    curve = 0;
+    nextCandidate = 0;
+    bestScore = HUGE_VAL;
+    filteredCount = 0;
+    abandonedCount = 0;
+}
+
+// Return the mannequin closest to curve, scored on threadsCount threads (the calling thread when it's 1).
+// The mannequins are only read, they must not be modified until it returns.
+MannequinMatch MannequinIdentifier::identify( const Curve& curve, int threadsCount )
+{
+    MannequinMatch match;
+    match.candidatesCount = mannequins->size();
+
+    this->curve = &curve;
+    candidates.clear();
+    nextCandidate = 0;
+    bestScore = HUGE_VAL;
+    bestId.clear();
+    filteredCount = 0;
+    abandonedCount = 0;
+
+    if( curve.isEmpty() )
+        return match;
+
+    QStringList names = mannequins->names();
+    for( int i=0; i<names.size(); ++i )
+    {
+        Candidate candidate;
+        if( makeCandidate( mannequins->mannequin( names[i] ), curve, candidate ) )
+            candidates.append( candidate );
+        else
+            filteredCount++;
+    }
+
+    // the most likely ones first, the sooner the best score is low the more candidates are skipped or abandoned early
+    qStableSort( candidates.begin(), candidates.end() );
+
+    threadsCount = qMin( threadsCount, candidates.size() );
+    if( threadsCount <= 1 )
+        scoreCandidates();
+    else
+    {
+        QList<IdentifierWorker*> workers;
+        for( int i=0; i<threadsCount; ++i )
+            workers.append( new IdentifierWorker( this ) );
+        for( int i=0; i<workers.size(); ++i )
+            workers[i]->start();
+        for( int i=0; i<workers.size(); ++i )
+            workers[i]->wait();
+        qDeleteAll( workers );
+    }
+
+    match.mannequinId = bestId;
+    if( !bestId.isEmpty() )
+    {
+        match.rmsDistance = float( sqrt( bestScore ) );
+        for( int i=0; i<candidates.size(); ++i )
+        {
+            if( candidates[i].mannequin->getName() == bestId )
+                match.testedPointsCount = candidates[i].pointsCount;
+        }
+    }
+    match.filteredCount = filteredCount;
+    match.abandonedCount = abandonedCount;
+
+    ESO_LOG_DEBUG << "Best match:" << match.mannequinId << "rms distance:" << match.rmsDistance << "candidates:" << match.candidatesCount
+                  << "filtered:" << match.filteredCount << "abandoned:" << match.abandonedCount;
+
+    this->curve = 0;
+    return match;
+}
+
+// The points below the bottom of the mecanical curve are ignored, as in CurveComparer::setIgnoredPoints() (the first one too here)
+bool MannequinIdentifier::isTested( const Mannequin& mannequin, const Point& p )
+{
+    return p.y >= mannequin[0].y;
+}
+
+// Find the points of curve tested against mannequin and the lower bound of its score, false if it can't be compared:
+// it has no segment (it would be at the distance 0 of everything) or the curve has no point within its heights.
+//
+// The lower bound is the mean squared distance of the points to the bounding box of the mecanical curve.
+// It is lowered a little for the rounding of the closest points, which can be a hair outside of the box.
+bool MannequinIdentifier::makeCandidate( const Mannequin* mannequin, const Curve& curve, Candidate& candidate )
+{
+    if( mannequin->size() < 2 )
+        return false;
+
+    Point boundsMin = mannequin->getBoundsMin();
+    Point boundsMax = mannequin->getBoundsMax();
+    double sum = 0.0;
+
+    candidate.mannequin = mannequin;
+    candidate.pointsCount = 0;
+    candidate.endIndex = 0;
+
+    while( candidate.endIndex < curve.size() && curve[candidate.endIndex].y <= mannequin->getMaxY() )
+    {
+        const Point& p = curve[candidate.endIndex++];
+        if( !isTested( *mannequin, p ) )
+            continue;
+
+        float dx = qMax( 0.0f, qMax( boundsMin.x - p.x, p.x - boundsMax.x ) );
+        float dy = qMax( 0.0f, qMax( boundsMin.y - p.y, p.y - boundsMax.y ) );
+        float dz = qMax( 0.0f, qMax( boundsMin.z - p.z, p.z - boundsMax.z ) );
+        sum += dx*dx + dy*dy + dz*dz;
+        candidate.pointsCount++;
+    }
+
+    if( candidate.pointsCount == 0 )
+        return false;
+
+    candidate.lowerBound = sum / candidate.pointsCount * 0.999;
+    return true;
+}
+
+// Next candidate to score, false when there is none left.
+// The candidates are sorted by lower bound, once one can't beat the best score none of the following can.
+bool MannequinIdentifier::takeCandidate( Candidate& candidate )
+{
+    QMutexLocker locker( &mutex );
+
+    if( nextCandidate < candidates.size() && candidates[nextCandidate].lowerBound > bestScore )
+    {
+        filteredCount += candidates.size() - nextCandidate;
+        nextCandidate = candidates.size();
+    }
+
+    if( nextCandidate >= candidates.size() )
+        return false;
+
+    candidate = candidates[nextCandidate++];
+    return true;
+}
+
+double MannequinIdentifier::getBestScore()
+{
+    QMutexLocker locker( &mutex );
+    return bestScore;
+}
+
+// Called from the worker threads, or from identify() with a single thread
+void MannequinIdentifier::scoreCandidates()
+{
+    Candidate candidate;
+    while( takeCandidate( candidate ) )
+        scoreCandidate( candidate );
+}
+
+void MannequinIdentifier::scoreCandidate( const Candidate& candidate )
+{
+    const Mannequin& mannequin = *candidate.mannequin;
+    const Curve& probeCurve = *curve;
+
+    // the best score seen by this thread can only be higher than the real one, abandoning over it is always right
+    double best = getBestScore();
+    double sum = 0.0;
+    int scoredCount = 0;
+
+    for( int i=0; i<candidate.endIndex; ++i )
+    {
+        if( !isTested( mannequin, probeCurve[i] ) )
+            continue;
+
+        float squaredDistance;
+        mannequin.findClosestPoint( probeCurve[i], 0, &squaredDistance );
+        sum += squaredDistance;
+
+        if( ++scoredCount % CheckInterval == 0 )
+            best = getBestScore();
+
+        // a candidate as good as the best one is kept to the end, for the name to decide
+        if( sum / candidate.pointsCount > best )
+        {
+            ESO_LOG_TRACE << mannequin.getName() << "abandoned after" << scoredCount << "points of" << candidate.pointsCount;
+            QMutexLocker locker( &mutex );
+            abandonedCount++;
+            return;
+        }
+    }
+
+    double score = sum / candidate.pointsCount;
+    ESO_LOG_TRACE << mannequin.getName() << "score:" << score;
+
+    QMutexLocker locker( &mutex );
+    if( score < bestScore || ( score == bestScore && mannequin.getName() < bestId ) )
+    {
+        bestScore = score;
+        bestId = mannequin.getName();
+    }
+}
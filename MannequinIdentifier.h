@@ -0,0 +1,96 @@
+#ifndef MANNEQUINIDENTIFIER_H
+#define MANNEQUINIDENTIFIER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QString>
+
+#include "MannequinRegistry.h"
+
+// Mannequin of the registry whose mecanical curve is the closest to a probe curve
+struct MannequinMatch
+{
+    QString mannequinId;        // empty if there is no mannequin to compare to
+    float   rmsDistance;        // root mean square of the distances between the tested probe points and the mecanical curve
+    int     testedPointsCount;  // probe points within the heights of the mannequin
+    int     candidatesCount;    // mannequins of the registry
+    int     filteredCount;      // skipped by the prefilters (heights or bounding box)
+    int     abandonedCount;     // abandoned while being scored, they couldn't beat the best one anymore
+
+    MannequinMatch();
+};
+
+class MannequinIdentifier;
+
+// One thread of the identification, it scores the candidates one after the other until there is none left
+class IdentifierWorker : public QThread
+{
+    private:
+        MannequinIdentifier*    identifier;
+
+    protected:
+        void    run();
+
+    public:
+        IdentifierWorker( MannequinIdentifier* identifier );
+};
+
+// Find the mannequin a probe curve was recorded on, when the station doesn't know it anymore.
+//
+// Only the probe points a validation would test are compared to a mannequin: the ones between the bottom of its mecanical
+// curve and its maxY (see CurveComparer::setIgnoredPoints()), a mannequin without any is not a candidate.
+// The score of a mannequin is the mean of the squared distances between these points and the points of its mecanical
+// curve closest to them (Matching::ClosestPoint, whatever the matching of the mannequin, it doesn't need the heights to match).
+// The lowest score is the best match, the mannequin with the first name wins if several have the same score.
+//
+// The squared distance of a point to the bounding box of a mecanical curve is never more than its distance to the curve,
+// so their mean is a lower bound of the score. The candidates are scored in the order of their lower bounds, on several
+// threads, and they are skipped when their lower bound is already over the best score found. While a candidate is scored,
+// its running sum only grows, so it is abandoned as soon as the sum over its points count is over the best score.
+// The result doesn't depend on the threads: a candidate is only dropped when it can't be the best match.
+class MannequinIdentifier
+{
+    friend class IdentifierWorker;
+
+    private:
+        struct Candidate
+        {
+            const Mannequin*    mannequin;
+            int                 endIndex;       // the points from endIndex on are above maxY
+            int                 pointsCount;    // tested points
+            double              lowerBound;
+
+            bool operator<( const Candidate& other ) const;
+        };
+
+        const MannequinRegistry*    mannequins;
+
+        // state of the identify() running
+        const Curve*        curve;
+        QList<Candidate>    candidates;     // sorted by lower bound
+        QMutex              mutex;          // for everything below
+        int                 nextCandidate;
+        double              bestScore;
+        QString             bestId;
+        int                 filteredCount;
+        int                 abandonedCount;
+
+        static const int    CheckInterval = 64; // points scored between two looks at the best score
+
+        static bool     isTested( const Mannequin& mannequin, const Point& p );
+        static bool     makeCandidate( const Mannequin* mannequin, const Curve& curve, Candidate& candidate );
+        bool            takeCandidate( Candidate& candidate );
+        void            scoreCandidates();
+        double          getBestScore();
+        void            scoreCandidate( const Candidate& candidate );
+
+        Q_DISABLE_COPY( MannequinIdentifier )
+
+    public:
+        MannequinIdentifier( const MannequinRegistry* mannequins );
+
+        MannequinMatch  identify( const Curve& curve, int threadsCount );
+};
+
+#endif // MANNEQUINIDENTIFIER_H
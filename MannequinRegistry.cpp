@@ -0,0 +1,44 @@
+#include "MannequinRegistry.h"
+
+MannequinRegistry::MannequinRegistry()
+{
+}
+
+MannequinRegistry::~MannequinRegistry()
+{
+    qDeleteAll( mannequins );
+}
+
+// Add an additionnal mannequin (the registry deletes it), a mannequin with the same name is replaced
+void MannequinRegistry::addMannequin( Mannequin* mannequin )
+{
+    delete mannequins.value( mannequin->getName() );
+    mannequins.insert( mannequin->getName(), mannequin );
+}
+
+// Return 0 if there is no mannequin with this name
+const Mannequin* MannequinRegistry::mannequin( const QString& mannequinId ) const
+{
+    return mannequins.value( mannequinId );
+}
+
+// To change the settings of a mannequin, while no validation is running
+Mannequin* MannequinRegistry::mannequin( const QString& mannequinId )
+{
+    return mannequins.value( mannequinId );
+}
+
+bool MannequinRegistry::contains( const QString& mannequinId ) const
+{
+    return mannequins.contains( mannequinId );
+}
+
+QStringList MannequinRegistry::names() const
+{
+    return mannequins.keys();
+}
+
+int MannequinRegistry::size() const
+{
+    return mannequins.size();
+}
@@ -0,0 +1,34 @@
+#ifndef MANNEQUINREGISTRY_H
+#define MANNEQUINREGISTRY_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include "Mannequin.h"
+
+// All the mannequins available for the validations (ex. BOB001, BOB002, ARN001, CAT001, ...), by name.
+// Once the mannequins are added, the registry is only read through a const pointer,
+// so any number of threads can validate curves against it at the same time without locks.
+// The mannequins must not be modified (ex. setRadius()) while validations are running.
+class MannequinRegistry
+{
+    private:
+        QMap<QString, Mannequin*> mannequins;
+
+        Q_DISABLE_COPY( MannequinRegistry )
+
+    public:
+        MannequinRegistry();
+        ~MannequinRegistry();
+
+        void                addMannequin( Mannequin* mannequin );
+
+        const Mannequin*    mannequin( const QString& mannequinId ) const;
+        Mannequin*          mannequin( const QString& mannequinId );
+        bool                contains( const QString& mannequinId ) const;
+        QStringList         names() const;
+        int                 size() const;
+};
+
+#endif // MANNEQUINREGISTRY_H
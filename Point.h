@@ -47,4 +47,7 @@ struct Point
     }
 };
 
+// points can be moved in memory without their constructor (QVector reallocates them with memcpy)
+Q_DECLARE_TYPEINFO( Point, Q_MOVABLE_TYPE );
+
 #endif // POINT_H
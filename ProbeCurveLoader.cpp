@@ -0,0 +1,404 @@
+#include "ProbeCurveLoader.h"
+
+#include <cfloat>
+#include <climits>
+#include <cstring>
+
+#include "Log.h"
+#include "StageMetrics.h"
+
+// powers of 10 that are exact in a double
+static const double PowersOf10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace( char c )
+{
+    return c == ' ' || c == '\t';
+}
+
+static inline bool isDigit( char c )
+{
+    return c >= '0' && c <= '9';
+}
+
+const qint64 ProbeCurveLoader::WindowSize;
+
+ProbeCurveLoader::ProbeCurveLoader()
+{
+    fileSize = 0;
+    windowOffset = 0;
+    windowSize = 0;
+    window = 0;
+    mapped = 0;
+    position = 0;
+    line = 1;
+}
+
+ProbeCurveLoader::~ProbeCurveLoader()
+{
+    close();
+}
+
+bool ProbeCurveLoader::open( const QString& filename )
+{
+    close();
+
+    file.setFileName( filename );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    fileSize = file.size();
+    position = 0;
+    line = 1;
+    errors.clear();
+
+    return fileSize == 0 || moveWindow( 0 );
+}
+
+void ProbeCurveLoader::close()
+{
+    unmapWindow();
+    buffer.clear();
+    if( file.isOpen() )
+        file.close();
+
+    fileSize = 0;
+    position = 0;
+}
+
+bool ProbeCurveLoader::atEnd() const
+{
+    return position >= fileSize;
+}
+
+// Map (or read when it can't be mapped) the part of the file from offset
+bool ProbeCurveLoader::moveWindow( qint64 offset )
+{
+    unmapWindow();
+
+    windowOffset = offset;
+    windowSize = qMin( WindowSize, fileSize - offset );
+
+    mapped = file.map( windowOffset, windowSize );
+    if( mapped )
+    {
+        window = reinterpret_cast<const char*>( mapped );
+        return true;
+    }
+
+    buffer.resize( windowSize );
+    if( !file.seek( windowOffset ) || file.read( buffer.data(), windowSize ) != windowSize )
+    {
+        windowSize = 0;
+        return false;
+    }
+    window = buffer.constData();
+
+    return true;
+}
+
+void ProbeCurveLoader::unmapWindow()
+{
+    if( mapped )
+        file.unmap( mapped );
+
+    mapped = 0;
+    window = 0;
+    windowSize = 0;
+}
+
+// Append to curve the points of the next lines of the file, at most maxPoints. Returns the number of points appended.
+int ProbeCurveLoader::read( Curve& curve, int maxPoints )
+{
+    int count = 0;
+    Point point( 0.0f, 0.0f, 0.0f );
+    Error error;
+
+    while( count < maxPoints && position < fileSize )
+    {
+        const char* windowEnd = window + windowSize;
+        const char* begin = window + ( position - windowOffset );
+        const char* newLine = static_cast<const char*>( memchr( begin, '\n', windowEnd - begin ) );
+
+        // the line goes on after the window, move the window to the beginning of the line
+        if( newLine == 0 && windowOffset + windowSize < fileSize )
+        {
+            if( position == windowOffset )
+            {
+                Error tooLong = { line, 1, "the line is longer than the reading window" };
+                errors.append( tooLong );
+                position = fileSize;
+                break;
+            }
+
+            if( !moveWindow( position ) )
+            {
+                Error readError = { line, 1, "can't read the file: " + file.errorString() };
+                errors.append( readError );
+                position = fileSize;
+                break;
+            }
+            continue;
+        }
+
+        const char* end = newLine ? newLine : windowEnd;
+
+        if( parseLine( begin, end, point, error ) )
+        {
+            curve.append( point );
+            count++;
+        }
+        else if( error.column > 0 )
+        {
+            error.line = line;
+            errors.append( error );
+        }
+
+        position += ( end - begin ) + ( newLine ? 1 : 0 );
+        line++;
+    }
+
+    return count;
+}
+
+// Parse one "x;y;z" line from begin to end (without its '\n'), the same way as the lines of the files.
+// For the points that don't come from a file (ex. the datagrams of the tracker)
+bool ProbeCurveLoader::parsePoint( const char* begin, const char* end, Point& point )
+{
+    Error error;
+    return parseLine( begin, end, point, error );
+}
+
+// Parse "x;y;z", spaces are allowed around the numbers. Returns false with error.column = 0 for an empty line.
+bool ProbeCurveLoader::parseLine( const char* begin, const char* end, Point& point, Error& error )
+{
+    if( end > begin && end[-1] == '\r' )
+        end--;
+
+    const char* p = begin;
+    while( p < end && isSpace( *p ) )
+        p++;
+
+    if( p == end )
+    {
+        error.column = 0;
+        return false;
+    }
+
+    float coordinates[3];
+    for( int i=0; i<3; ++i )
+    {
+        const char* fieldBegin = p;
+        bool parsed = parseNumber( p, end, coordinates[i] );
+
+        while( p < end && isSpace( *p ) )
+            p++;
+
+        bool separated = ( i < 2 ) ? ( p < end && *p == ';' ) : ( p == end );
+
+        // too many digits or a big exponent for parseNumber() (ex. "0.12345678901234567", "1e-30"), QByteArray::toDouble() parses
+        // all the forms toFloat() accepts. Infinite and overflowing numbers are errors
+        if( !parsed || !separated )
+        {
+            const char* fieldEnd = fieldBegin;
+            while( fieldEnd < end && *fieldEnd != ';' )
+                fieldEnd++;
+            const char* fieldLast = fieldEnd;
+            while( fieldLast > fieldBegin && isSpace( fieldLast[-1] ) )
+                fieldLast--;
+
+            // x and y must be followed by ';', z by the end of the line
+            bool fieldSeparated = ( i < 2 ) ? ( fieldEnd < end ) : ( fieldEnd == end );
+
+            bool ok = false;
+            double value = QByteArray( fieldBegin, fieldLast - fieldBegin ).toDouble( &ok );
+            if( ok && fieldSeparated && qAbs( value ) <= FLT_MAX )
+            {
+                coordinates[i] = float( value );
+                p = fieldEnd;
+                separated = true;
+            }
+            else
+            {
+                while( fieldBegin < end && isSpace( *fieldBegin ) )
+                    fieldBegin++;
+
+                if( !parsed )
+                {
+                    error.column = fieldBegin - begin + 1;
+                    error.message = QString( "expected a number for %1" ).arg( QString( QChar( 'x' + i ) ) );
+                }
+                else if( i < 2 )
+                {
+                    error.column = p - begin + 1;
+                    error.message = p < end ? QString( "expected ';' after %1" ).arg( QString( QChar( 'x' + i ) ) )
+                                            : QString( "the line ends after %1, 3 numbers are expected" ).arg( QString( QChar( 'x' + i ) ) );
+                }
+                else
+                {
+                    error.column = p - begin + 1;
+                    error.message = "unexpected characters after z, 3 numbers are expected";
+                }
+                return false;
+            }
+        }
+
+        if( i < 2 )
+        {
+            p++;    // ';'
+            while( p < end && isSpace( *p ) )
+                p++;
+        }
+    }
+
+    point = Point( coordinates[0], coordinates[1], coordinates[2] );
+    return true;
+}
+
+// Parse a decimal number like "-17.9064" or "2.5e-3" at p, and move p after it.
+// Returns false if it's not a number or if it has too many digits to be parsed exactly this way.
+// The result is exactly the one of QString::toFloat(): the double closest to the number, then converted to float.
+// With at most 15 significant digits and a power of 10 up to 22, the mantissa and the power of 10 are both exact doubles,
+// so one multiplication or division gives the closest double.
+bool ProbeCurveLoader::parseNumber( const char*& p, const char* end, float& value )
+{
+    const char* s = p;
+    bool negative = false;
+
+    if( s < end && ( *s == '-' || *s == '+' ) )
+    {
+        negative = ( *s == '-' );
+        s++;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;             // significant digits in the mantissa
+    int exponent = 0;
+    bool anyDigit = false;
+
+    for( ; s < end && isDigit( *s ); ++s )
+    {
+        anyDigit = true;
+        if( mantissa == 0 && *s == '0' )
+            continue;
+        if( digits < 19 )
+            mantissa = mantissa * 10 + ( *s - '0' );
+        else
+            exponent++;
+        digits++;
+    }
+
+    if( s < end && *s == '.' )
+    {
+        for( ++s; s < end && isDigit( *s ); ++s )
+        {
+            anyDigit = true;
+            if( mantissa == 0 && *s == '0' )
+            {
+                exponent--;
+                continue;
+            }
+            if( digits < 19 )
+            {
+                mantissa = mantissa * 10 + ( *s - '0' );
+                exponent--;
+            }
+            digits++;
+        }
+    }
+
+    if( !anyDigit )
+        return false;
+
+    if( s < end && ( *s == 'e' || *s == 'E' ) )
+    {
+        const char* e = s + 1;
+        bool negativeExponent = false;
+        if( e < end && ( *e == '-' || *e == '+' ) )
+        {
+            negativeExponent = ( *e == '-' );
+            e++;
+        }
+
+        if( e == end || !isDigit( *e ) )
+            return false;
+
+        int exponentValue = 0;
+        for( ; e < end && isDigit( *e ); ++e )
+        {
+            if( exponentValue < 10000 )
+                exponentValue = exponentValue * 10 + ( *e - '0' );
+        }
+        exponent += negativeExponent ? -exponentValue : exponentValue;
+        s = e;
+    }
+
+    if( digits > 15 || exponent < -22 || exponent > 22 )
+        return false;
+
+    double result = double( mantissa );
+    if( exponent < 0 )
+        result /= PowersOf10[-exponent];
+    else
+        result *= PowersOf10[exponent];
+
+    if( result > FLT_MAX )
+        return false;
+
+    value = float( negative ? -result : result );
+    p = s;
+    return true;
+}
+
+const QList<ProbeCurveLoader::Error>& ProbeCurveLoader::getErrors() const
+{
+    return errors;
+}
+
+// Number of the next line to read
+int ProbeCurveLoader::getLine() const
+{
+    return line;
+}
+
+// Replace the points of curve with the ones of the file, return false if the file can't be opened.
+// The lines skipped are logged, and added to errors when it's given.
+bool ProbeCurveLoader::load( const QString& filename, Curve& curve, QList<Error>* errors )
+{
+    StageTimer timer( Stage::CsvLoad, 0 );
+    ProbeCurveLoader loader;
+    curve.clear();
+
+    if( !loader.open( filename ) )
+        return false;
+
+    // a line like "2.1306;-17.9064;-2.1112" is about 24 characters
+    curve.reserve( loader.fileSize / 24 + 1 );
+    loader.read( curve, INT_MAX );
+    timer.setItems( curve.size() );
+
+    for( int i=0; i<loader.errors.size(); ++i )
+    {
+        const Error& error = loader.errors[i];
+        ESO_LOG_WARNING << QString( "%1:%2:%3: %4" ).arg( filename ).arg( error.line ).arg( error.column ).arg( error.message );
+    }
+
+    if( errors )
+        *errors = loader.errors;
+
+    return true;
+}
+
+// The curve must be deleted by the caller, it is empty if the file can't be opened
+Curve* ProbeCurveLoader::load( const QString& filename )
+{
+    Curve* probeCurve = new Curve();
+    load( filename, *probeCurve );
+
+    ESO_LOG_INFO << filename << "loaded. It contains " << probeCurve->size() << " points.";
+
+    return probeCurve;
+}
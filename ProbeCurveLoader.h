@@ -0,0 +1,75 @@
+#ifndef PROBECURVELOADER_H
+#define PROBECURVELOADER_H
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include "Curve.h"
+
+// Load the points of a probe curve from a csv file ("x;y;z" on each line).
+// The data is collected from a metrics csv file, parsed to be easier to read.
+//
+// The file is memory mapped by windows of WindowSize bytes and the numbers are parsed in place, without copying the lines.
+// They are the same floats as QString::toFloat() gives. The lines that are not 3 numbers are skipped, with their line
+// and column in getErrors(). The empty lines are skipped silently.
+//
+// load() reads the whole file in a Curve. For the files too big for that, open() the file and read() it by chunks:
+//
+//  ProbeCurveLoader loader;
+//  loader.open( filename );
+//  while( !loader.atEnd() )
+//  {
+//      chunk.clear();
+//      loader.read( chunk, 1000000 );
+//      ...
+//  }
+class ProbeCurveLoader
+{
+    public:
+        struct Error
+        {
+            int     line;       // from 1
+            int     column;     // from 1
+            QString message;
+        };
+
+        static const qint64 WindowSize = 64 * 1024 * 1024;
+
+    private:
+        QFile           file;
+        qint64          fileSize;
+        qint64          windowOffset;   // offset in the file of the part mapped
+        qint64          windowSize;
+        const char*     window;
+        uchar*          mapped;         // 0 when the file can't be mapped and the window is read in buffer
+        QByteArray      buffer;
+        qint64          position;       // offset in the file of the next line
+        int             line;           // number of the next line
+        QList<Error>    errors;
+
+        bool    moveWindow( qint64 offset );
+        void    unmapWindow();
+        static bool parseLine( const char* begin, const char* end, Point& point, Error& error );
+        static bool parseNumber( const char*& p, const char* end, float& value );
+
+        Q_DISABLE_COPY( ProbeCurveLoader )
+
+    public:
+        ProbeCurveLoader();
+        ~ProbeCurveLoader();
+
+        bool    open( const QString& filename );
+        void    close();
+        bool    atEnd() const;
+        int     read( Curve& curve, int maxPoints );
+
+        const QList<Error>& getErrors() const;
+        int     getLine() const;
+
+        static bool     load( const QString& filename, Curve& curve, QList<Error>* errors = 0 );
+        static Curve*   load( const QString& filename );
+        static bool     parsePoint( const char* begin, const char* end, Point& point );
+};
+
+#endif // PROBECURVELOADER_H
@@ -0,0 +1,578 @@
+#include "ProbeRecording.h"
+
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Log.h"
+#include "StageMetrics.h"
+
+static const quint32 RecordingMagic = 0x52505345;         // "ESPR"
+static const quint32 RecordingVersion = 1;
+static const quint32 RecordingChunkMagic = 0x4b4e4843;    // "CHNK"
+
+static const quint16 ChunkCompressed = 0x1;
+
+static int paddedSize( int size )
+{
+    return ( size + 3 ) & ~3;
+}
+
+// FNV-1a, like the mannequin cache: enough to find a chunk that was not written entirely
+static quint32 recordingChecksum( const uchar* data, qint64 size )
+{
+    quint32 hash = 2166136261u;
+    for( qint64 i=0; i<size; ++i )
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline quint32 floatBits( float value )
+{
+    quint32 bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    return bits;
+}
+
+static inline float bitsFloat( quint32 bits )
+{
+    float value;
+    memcpy( &value, &bits, sizeof( value ) );
+    return value;
+}
+
+// Append the difference of bits with previous as a zigzag varint: the small differences, positive or negative, take few bytes
+static inline void appendDelta( QByteArray& data, quint32 bits, quint32 previous )
+{
+    qint32 delta = qint32( bits - previous );
+    quint32 zigzag = ( quint32( delta ) << 1 ) ^ quint32( delta >> 31 );
+
+    while( zigzag >= 0x80 )
+    {
+        data.append( char( ( zigzag & 0x7f ) | 0x80 ) );
+        zigzag >>= 7;
+    }
+    data.append( char( zigzag ) );
+}
+
+// Read a delta at p and move p after it, false if it goes past end
+static inline bool readDelta( const uchar*& p, const uchar* end, quint32 previous, quint32& bits )
+{
+    quint32 zigzag = 0;
+    for( int shift=0; shift<35; shift+=7 )
+    {
+        if( p == end )
+            return false;
+
+        uchar byte = *p++;
+        zigzag |= quint32( byte & 0x7f ) << shift;
+        if( !( byte & 0x80 ) )
+        {
+            qint32 delta = qint32( zigzag >> 1 ) ^ -qint32( zigzag & 1 );
+            bits = previous + quint32( delta );
+            return true;
+        }
+    }
+    return false;
+}
+
+// Wait until what was written to the file is on the disk
+static bool syncFile( QFile& file )
+{
+    if( !file.flush() )
+        return false;
+#ifdef Q_OS_WIN
+    return _commit( file.handle() ) == 0;
+#else
+    return fsync( file.handle() ) == 0;
+#endif
+}
+
+
+ProbeRecordingWriter::ProbeRecordingWriter()
+{
+    encoding = RecordingEncoding::Delta;
+    compressed = false;
+    chunkSize = 4096;
+    pointsCount = 0;
+}
+
+ProbeRecordingWriter::~ProbeRecordingWriter()
+{
+    close();
+}
+
+// Start a new recording, an existing file is replaced
+bool ProbeRecordingWriter::open( const QString& filename, const RecordingInfo& info,
+                                 RecordingEncoding::Encoding encoding, bool compressed, int chunkSize )
+{
+    close();
+
+    this->encoding = encoding;
+    this->compressed = compressed;
+    this->chunkSize = qMax( chunkSize, 1 );
+    pointsCount = 0;
+    pending.clear();
+    pending.reserve( this->chunkSize );
+
+    file.setFileName( filename );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    QByteArray mannequinId = info.mannequinId.toUtf8();
+
+    RecordingHeader header;
+    header.magic = RecordingMagic;
+    header.version = RecordingVersion;
+    header.headerSize = sizeof( RecordingHeader );
+    header.frame = info.frame;
+    header.sampleRate = info.sampleRate;
+    header.mannequinIdSize = mannequinId.size();
+
+    QByteArray data( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    data.append( mannequinId );
+    data.append( QByteArray( paddedSize( mannequinId.size() ) - mannequinId.size(), '\0' ) );
+
+    if( file.write( data ) != data.size() )
+    {
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool ProbeRecordingWriter::isOpen() const
+{
+    return file.isOpen();
+}
+
+bool ProbeRecordingWriter::append( const Point& point )
+{
+    pending.append( point );
+
+    if( pending.size() >= chunkSize )
+        return writeChunk();
+
+    return true;
+}
+
+bool ProbeRecordingWriter::append( const Curve& curve )
+{
+    for( int i=0; i<curve.size(); ++i )
+    {
+        if( !append( curve[i] ) )
+            return false;
+    }
+    return true;
+}
+
+// Write the pending points as one chunk: header and data in one write, so a chunk is either complete or has a wrong checksum
+bool ProbeRecordingWriter::writeChunk()
+{
+    if( pending.isEmpty() )
+        return true;
+    if( !file.isOpen() )
+        return false;
+
+    int count = pending.size();
+    chunk.resize( sizeof( RecordingChunkHeader ) );
+
+    if( encoding == RecordingEncoding::Raw )
+    {
+        for( int i=0; i<count; ++i )
+        {
+            float coordinates[3] = { pending[i].x, pending[i].y, pending[i].z };
+            chunk.append( reinterpret_cast<const char*>( coordinates ), sizeof( coordinates ) );
+        }
+    }
+    else
+    {
+        // one coordinate after the other, the differences between neighbours are smaller than between x, y and z
+        for( int c=0; c<3; ++c )
+        {
+            quint32 previous = 0;
+            for( int i=0; i<count; ++i )
+            {
+                const Point& point = pending[i];
+                quint32 bits = floatBits( c == 0 ? point.x : ( c == 1 ? point.y : point.z ) );
+                appendDelta( chunk, bits, previous );
+                previous = bits;
+            }
+        }
+    }
+
+    RecordingChunkHeader header;
+    header.magic = RecordingChunkMagic;
+    header.encoding = encoding;
+    header.flags = 0;
+    header.pointsCount = count;
+    header.reserved = 0;
+
+    // kept uncompressed when it is not smaller
+    if( compressed )
+    {
+        QByteArray packed = qCompress( reinterpret_cast<const uchar*>( chunk.constData() ) + sizeof( header ),
+                                       chunk.size() - sizeof( header ) );
+        if( packed.size() < chunk.size() - (int)sizeof( header ) )
+        {
+            chunk.resize( sizeof( header ) );
+            chunk.append( packed );
+            header.flags |= ChunkCompressed;
+        }
+    }
+
+    header.dataSize = chunk.size() - sizeof( header );
+    header.checksum = recordingChecksum( reinterpret_cast<const uchar*>( chunk.constData() ) + sizeof( header ), header.dataSize );
+    memcpy( chunk.data(), &header, sizeof( header ) );
+    chunk.append( QByteArray( paddedSize( header.dataSize ) - header.dataSize, '\0' ) );
+
+    if( file.write( chunk ) != chunk.size() )
+        return false;
+
+    pointsCount += count;
+    pending.resize( 0 );    // keeps the memory reserved, unlike clear()
+    return true;
+}
+
+// Write the pending points, even if they don't fill a chunk
+bool ProbeRecordingWriter::flush()
+{
+    return writeChunk() && file.flush();
+}
+
+// Write the pending points and wait until the file is on the disk: what was appended so far survives a crash
+bool ProbeRecordingWriter::sync()
+{
+    return writeChunk() && syncFile( file );
+}
+
+bool ProbeRecordingWriter::close()
+{
+    if( !file.isOpen() )
+        return true;
+
+    bool written = flush();
+    file.close();
+    return written;
+}
+
+// Points written to the file, without the pending ones
+qint64 ProbeRecordingWriter::getPointsCount() const
+{
+    return pointsCount;
+}
+
+QString ProbeRecordingWriter::getErrorString() const
+{
+    return file.errorString();
+}
+
+bool ProbeRecordingWriter::save( const QString& filename, const Curve& curve, const RecordingInfo& info,
+                                 RecordingEncoding::Encoding encoding, bool compressed )
+{
+    ProbeRecordingWriter writer;
+
+    return writer.open( filename, info, encoding, compressed )
+        && writer.append( curve )
+        && writer.close();
+}
+
+
+ProbeRecordingReader::ProbeRecordingReader()
+{
+    mapped = 0;
+    pointsCount = 0;
+    damaged = false;
+}
+
+ProbeRecordingReader::~ProbeRecordingReader()
+{
+    close();
+}
+
+// Map the file and find its chunks, false if it is not a recording
+bool ProbeRecordingReader::open( const QString& filename )
+{
+    close();
+
+    file.setFileName( filename );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    qint64 fileSize = file.size();
+    if( fileSize < (qint64)sizeof( RecordingHeader ) )
+    {
+        close();
+        return false;
+    }
+
+    const uchar* data = mapped = file.map( 0, fileSize );
+    if( !data )
+    {
+        content = file.readAll();
+        if( content.size() != fileSize )
+        {
+            close();
+            return false;
+        }
+        data = reinterpret_cast<const uchar*>( content.constData() );
+    }
+
+    const RecordingHeader* header = reinterpret_cast<const RecordingHeader*>( data );
+    if( header->magic != RecordingMagic || header->version != RecordingVersion
+        || header->headerSize != sizeof( RecordingHeader )
+        || header->mannequinIdSize > fileSize - sizeof( RecordingHeader ) )
+    {
+        close();
+        return false;
+    }
+
+    info.mannequinId = QString::fromUtf8( reinterpret_cast<const char*>( data + sizeof( RecordingHeader ) ), header->mannequinIdSize );
+    info.sampleRate = header->sampleRate;
+    info.frame = ( header->frame == CoordinateFrame::Tracker ) ? CoordinateFrame::Tracker : CoordinateFrame::Mannequin;
+
+    // the chunks up to the first one incomplete or damaged
+    qint64 offset = sizeof( RecordingHeader ) + paddedSize( header->mannequinIdSize );
+    while( offset < fileSize )
+    {
+        const RecordingChunkHeader* chunkHeader = reinterpret_cast<const RecordingChunkHeader*>( data + offset );
+        qint64 dataOffset = offset + sizeof( RecordingChunkHeader );
+
+        if( dataOffset > fileSize
+            || chunkHeader->magic != RecordingChunkMagic
+            || chunkHeader->encoding > RecordingEncoding::Delta
+            || chunkHeader->dataSize > fileSize - dataOffset
+            || ( chunkHeader->encoding == RecordingEncoding::Raw && !( chunkHeader->flags & ChunkCompressed )
+                 && chunkHeader->dataSize != chunkHeader->pointsCount * 3 * sizeof( float ) )
+            || chunkHeader->checksum != recordingChecksum( data + dataOffset, chunkHeader->dataSize ) )
+        {
+            damaged = true;
+            break;
+        }
+
+        Chunk chunk;
+        chunk.data = data + dataOffset;
+        chunk.dataSize = chunkHeader->dataSize;
+        chunk.pointsCount = chunkHeader->pointsCount;
+        chunk.encoding = chunkHeader->encoding;
+        chunk.flags = chunkHeader->flags;
+        chunks.append( chunk );
+        pointsCount += chunk.pointsCount;
+
+        offset = dataOffset + paddedSize( chunkHeader->dataSize );
+    }
+
+    if( damaged )
+        ESO_LOG_WARNING << filename << "is damaged after" << pointsCount << "points, the rest of the recording is ignored.";
+
+    return true;
+}
+
+void ProbeRecordingReader::close()
+{
+    if( mapped )
+        file.unmap( mapped );
+    if( file.isOpen() )
+        file.close();
+
+    mapped = 0;
+    content.clear();
+    info = RecordingInfo();
+    chunks.clear();
+    pointsCount = 0;
+    damaged = false;
+}
+
+const RecordingInfo& ProbeRecordingReader::getInfo() const
+{
+    return info;
+}
+
+// Points of the chunks that are complete
+qint64 ProbeRecordingReader::getPointsCount() const
+{
+    return pointsCount;
+}
+
+// The end of the file is not a complete chunk (the recording was interrupted) or a chunk is damaged
+bool ProbeRecordingReader::isDamaged() const
+{
+    return damaged;
+}
+
+int ProbeRecordingReader::chunksCount() const
+{
+    return chunks.size();
+}
+
+int ProbeRecordingReader::chunkPointsCount( int chunk ) const
+{
+    return chunks[chunk].pointsCount;
+}
+
+// The points of a Raw uncompressed chunk where they are in the file, an empty view for the other chunks
+// (the Delta chunks of the default encoding too), see the overload below for those
+CurveView ProbeRecordingReader::chunkView( int chunk ) const
+{
+    CurveView view;
+    const Chunk& c = chunks[chunk];
+
+    if( c.encoding == RecordingEncoding::Raw && !( c.flags & ChunkCompressed ) )
+    {
+        view.coordinates = reinterpret_cast<const float*>( c.data );
+        view.count = c.pointsCount;
+    }
+    return view;
+}
+
+// Same as above, the chunks that can't be read in place are decoded in buffer and the view is in it (valid until the
+// buffer is modified). An empty view if the chunk can't be decoded.
+CurveView ProbeRecordingReader::chunkView( int chunk, QVector<float>& buffer ) const
+{
+    CurveView view = chunkView( chunk );
+    if( view.size() > 0 || chunks[chunk].pointsCount == 0 )
+        return view;
+
+    Curve curve;
+    if( !readChunk( chunk, curve ) )
+        return view;
+
+    buffer.resize( 3 * curve.size() );
+    for( int i=0; i<curve.size(); ++i )
+    {
+        buffer[3*i] = curve[i].x;
+        buffer[3*i+1] = curve[i].y;
+        buffer[3*i+2] = curve[i].z;
+    }
+
+    view.coordinates = buffer.constData();
+    view.count = curve.size();
+    return view;
+}
+
+// Append the points of a chunk to curve
+bool ProbeRecordingReader::readChunk( int chunk, Curve& curve ) const
+{
+    return decodeChunk( chunks[chunk], curve );
+}
+
+// Append all the points to curve
+bool ProbeRecordingReader::read( Curve& curve ) const
+{
+    curve.reserve( curve.size() + pointsCount );
+
+    for( int i=0; i<chunks.size(); ++i )
+    {
+        if( !decodeChunk( chunks[i], curve ) )
+            return false;
+    }
+    return true;
+}
+
+bool ProbeRecordingReader::decodeChunk( const Chunk& chunk, Curve& curve ) const
+{
+    const uchar* data = chunk.data;
+    quint32 dataSize = chunk.dataSize;
+
+    QByteArray unpacked;
+    if( chunk.flags & ChunkCompressed )
+    {
+        unpacked = qUncompress( data, dataSize );
+        if( unpacked.isEmpty() )
+            return false;
+        data = reinterpret_cast<const uchar*>( unpacked.constData() );
+        dataSize = unpacked.size();
+    }
+
+    int count = chunk.pointsCount;
+
+    if( chunk.encoding == RecordingEncoding::Raw )
+    {
+        if( dataSize != count * 3 * sizeof( float ) )
+            return false;
+
+        // memcpy, the uncompressed data is not aligned like the mapped file
+        for( int i=0; i<count; ++i )
+        {
+            float coordinates[3];
+            memcpy( coordinates, data + i * sizeof( coordinates ), sizeof( coordinates ) );
+            curve.append( Point( coordinates[0], coordinates[1], coordinates[2] ) );
+        }
+        return true;
+    }
+
+    // each float takes at least a byte
+    if( quint32( count ) > dataSize / 3 )
+        return false;
+
+    int first = curve.size();
+    curve.resize( first + count );
+
+    const uchar* p = data;
+    const uchar* end = data + dataSize;
+    for( int c=0; c<3; ++c )
+    {
+        quint32 bits = 0;
+        for( int i=0; i<count; ++i )
+        {
+            if( !readDelta( p, end, bits, bits ) )
+            {
+                curve.resize( first );
+                return false;
+            }
+
+            Point& point = curve[first + i];
+            if( c == 0 )
+                point = Point( bitsFloat( bits ), 0.0f, 0.0f );
+            else if( c == 1 )
+                point.y = bitsFloat( bits );
+            else
+                point.z = bitsFloat( bits );
+        }
+    }
+
+    return p == end;
+}
+
+// The file starts like a recording, to choose between this reader and the csv one
+bool ProbeRecordingReader::isRecording( const QString& filename )
+{
+    QFile file( filename );
+    quint32 magic = 0;
+
+    return file.open( QIODevice::ReadOnly )
+        && file.read( reinterpret_cast<char*>( &magic ), sizeof( magic ) ) == sizeof( magic )
+        && magic == RecordingMagic;
+}
+
+// Replace the points of curve with the ones of the recording, false if it can't be read
+bool ProbeRecordingReader::load( const QString& filename, Curve& curve, RecordingInfo* info )
+{
+    StageTimer timer( Stage::RecordingLoad, 0 );
+    ProbeRecordingReader reader;
+    curve.clear();
+
+    if( !reader.open( filename ) )
+        return false;
+
+    if( info )
+        *info = reader.getInfo();
+
+    if( !reader.read( curve ) )
+    {
+        ESO_LOG_WARNING << filename << "has a chunk that can't be decoded.";
+        curve.clear();
+        return false;
+    }
+
+    timer.setItems( curve.size() );
+    return true;
+}
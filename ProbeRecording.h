@@ -0,0 +1,173 @@
+#ifndef PROBERECORDING_H
+#define PROBERECORDING_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+#include "Curve.h"
+
+// Binary recording of a probe session (.probe), smaller and much faster to load than the csv files.
+//
+// file:  RecordingHeader, the mannequin id in utf-8 (padded to 4 bytes), then the chunks one after the other
+// chunk: RecordingChunkHeader, then the points of the chunk (padded to 4 bytes), encoded as:
+//  - Raw:   x, y, z of each point as floats, read directly from the mapped file (see CurveView)
+//  - Delta: x of all the points, then y, then z. Each float is the difference of its bits with the ones of the
+//           float before it, as a zigzag varint. The points are exactly the ones recorded, usually in 6 to 8 bytes.
+// and optionally compressed with qCompress().
+// Only the Raw chunks that are not compressed can be read in place. The writer (and EsoConvert) write Delta chunks
+// by default, the smallest files: a file meant to be read in place must be written Raw and without compression.
+//
+// The header is never written again once the recording started and a chunk is written at once with its checksum:
+// when a session is interrupted (crash, power loss), the file is valid up to the last chunk written entirely.
+// The chunks after a damaged one are ignored by the reader.
+// Like the mannequin cache, the file is in the byte order of the machine.
+
+namespace RecordingEncoding
+{
+    enum Encoding
+    {
+        Raw = 0,
+        Delta = 1
+    };
+}
+
+namespace CoordinateFrame
+{
+    enum Frame
+    {
+        Mannequin = 0,      // the coordinates of the mannequin file, the ones the validation uses
+        Tracker = 1         // raw coordinates of the tracker, not calibrated to the mannequin
+    };
+}
+
+struct RecordingInfo
+{
+    QString                 mannequinId;    // mannequin the probe was in, empty if unknown
+    float                   sampleRate;     // points per second, 0 if unknown
+    CoordinateFrame::Frame  frame;
+
+    RecordingInfo() : sampleRate( 0.0f ), frame( CoordinateFrame::Mannequin ) {}
+};
+
+struct RecordingHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 headerSize;
+    quint32 frame;
+    float   sampleRate;
+    quint32 mannequinIdSize;
+};
+
+struct RecordingChunkHeader
+{
+    quint32 magic;
+    quint16 encoding;
+    quint16 flags;
+    quint32 pointsCount;
+    quint32 dataSize;       // bytes stored after this header, without the padding
+    quint32 checksum;       // of the bytes stored
+    quint32 reserved;
+};
+
+// Points of a Raw chunk in the mapped file, valid until the reader is closed (or in the buffer of the reader for
+// the other chunks, see ProbeRecordingReader::chunkView())
+struct CurveView
+{
+    const float*    coordinates;    // x, y, z of each point
+    int             count;
+
+    CurveView() : coordinates( 0 ), count( 0 ) {}
+
+    int     size() const { return count; }
+    Point   operator[]( int i ) const { return Point( coordinates[3*i], coordinates[3*i+1], coordinates[3*i+2] ); }
+};
+
+// Record a session: the points appended are written by chunks of chunkSize points.
+// sync() writes the points appended so far and waits until they are on the disk, it can be called at any time.
+class ProbeRecordingWriter
+{
+    private:
+        QFile                       file;
+        RecordingEncoding::Encoding encoding;
+        bool                        compressed;
+        int                         chunkSize;
+        Curve                       pending;        // appended, not written yet
+        QByteArray                  chunk;          // reused to encode the chunks
+        qint64                      pointsCount;
+
+        bool    writeChunk();
+
+        Q_DISABLE_COPY( ProbeRecordingWriter )
+
+    public:
+        ProbeRecordingWriter();
+        ~ProbeRecordingWriter();
+
+        bool    open( const QString& filename, const RecordingInfo& info,
+                      RecordingEncoding::Encoding encoding = RecordingEncoding::Delta, bool compressed = false, int chunkSize = 4096 );
+        bool    isOpen() const;
+        bool    append( const Point& point );
+        bool    append( const Curve& curve );
+        bool    flush();
+        bool    sync();
+        bool    close();
+
+        qint64  getPointsCount() const;
+        QString getErrorString() const;
+
+        static bool save( const QString& filename, const Curve& curve, const RecordingInfo& info,
+                          RecordingEncoding::Encoding encoding = RecordingEncoding::Delta, bool compressed = false );
+};
+
+// Read a recording from the mapped file (read in memory when it can't be mapped)
+class ProbeRecordingReader
+{
+    private:
+        struct Chunk
+        {
+            const uchar*    data;
+            quint32         dataSize;
+            quint32         pointsCount;
+            quint16         encoding;
+            quint16         flags;
+        };
+
+        QFile           file;
+        uchar*          mapped;
+        QByteArray      content;        // the file when it can't be mapped
+        RecordingInfo   info;
+        QList<Chunk>    chunks;
+        qint64          pointsCount;
+        bool            damaged;
+
+        bool    decodeChunk( const Chunk& chunk, Curve& curve ) const;
+
+        Q_DISABLE_COPY( ProbeRecordingReader )
+
+    public:
+        ProbeRecordingReader();
+        ~ProbeRecordingReader();
+
+        bool    open( const QString& filename );
+        void    close();
+
+        const RecordingInfo& getInfo() const;
+        qint64  getPointsCount() const;
+        bool    isDamaged() const;
+
+        int         chunksCount() const;
+        int         chunkPointsCount( int chunk ) const;
+        CurveView   chunkView( int chunk ) const;
+        CurveView   chunkView( int chunk, QVector<float>& buffer ) const;
+        bool        readChunk( int chunk, Curve& curve ) const;
+        bool        read( Curve& curve ) const;
+
+        static bool isRecording( const QString& filename );
+        static bool load( const QString& filename, Curve& curve, RecordingInfo* info = 0 );
+};
+
+#endif // PROBERECORDING_H
@@ -0,0 +1,98 @@
+#include "RadiusSweep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "CurveComparer.h"
+#include "DistanceKernels.h"
+
+RadiusSweep::RadiusSweep()
+{
+    mannequin = 0;
+    alwaysInvalidCount = 0;
+}
+
+// Validate curve once, the cost of a whole sweep
+void RadiusSweep::compute( const Mannequin* mannequin, const Curve& curve )
+{
+    this->mannequin = mannequin;
+    squaredDistances.clear();
+    alwaysInvalidCount = 0;
+
+    CurveComparer::isCurveValid<Evaluation::FullDiagnostics>( mannequin, curve, result, HUGE_VALF );
+    if( mannequin == 0 )
+        return;
+
+    squaredDistances.reserve( curve.size() );
+    for( int i=0; i<result.size(); ++i )
+    {
+        if( result.getVerdict( i ) == PointValidity::Ignored )
+            continue;
+
+        float squaredDistance = result.getSquaredDistance( i );
+        if( squaredDistance != squaredDistance )
+            alwaysInvalidCount++;
+        else
+            squaredDistances.push_back( squaredDistance );
+    }
+
+    std::sort( squaredDistances.begin(), squaredDistances.end() );
+}
+
+CurveValidity::Status RadiusSweep::statusAt( float radius ) const
+{
+    if( mannequin == 0 )
+        return CurveValidity::MannequinUnavailable;
+
+    if( invalidPointsCountAt( radius ) > 0 )
+        return CurveValidity::Invalid;
+
+    return result.getStatus();
+}
+
+// Same comparison as CurveComparer::isCurveValid(), the squared distances with the largest one within the radius
+int RadiusSweep::validPointsCountAt( float radius ) const
+{
+    float squaredRadius = DistanceKernels::squaredRadius( radius );
+    return std::upper_bound( squaredDistances.begin(), squaredDistances.end(), squaredRadius ) - squaredDistances.begin();
+}
+
+int RadiusSweep::invalidPointsCountAt( float radius ) const
+{
+    return getTestedPointsCount() - validPointsCountAt( radius );
+}
+
+int RadiusSweep::getIgnoredPointsCount() const
+{
+    return result.getIgnoredPointsCount();
+}
+
+int RadiusSweep::getTestedPointsCount() const
+{
+    return squaredDistances.size() + alwaysInvalidCount;
+}
+
+// Smallest radius with all the tested points valid, -1 if there is none (a distance is infinite or not a number).
+// A point is valid when sqrt( squaredDistance ) <= radius, so it's the square root of the largest squared distance.
+float RadiusSweep::smallestRadiusWithoutInvalidPoints() const
+{
+    if( alwaysInvalidCount > 0 )
+        return -1.0f;
+    if( squaredDistances.isEmpty() )
+        return 0.0f;
+
+    float largest = squaredDistances.back();
+    if( largest == HUGE_VALF )
+        return -1.0f;
+
+    return sqrt( largest );
+}
+
+// Smallest radius at which the curve is Valid, -1 if it isn't at any radius (ex. not enough points or not long enough)
+float RadiusSweep::smallestValidRadius() const
+{
+    if( mannequin == 0 || result.getStatus() != CurveValidity::Valid )
+        return -1.0f;
+
+    return smallestRadiusWithoutInvalidPoints();
+}
@@ -0,0 +1,41 @@
+#ifndef RADIUSSWEEP_H
+#define RADIUSSWEEP_H
+
+#include <QVector>
+
+#include "Curve.h"
+#include "ValidationResult.h"
+
+// Status of a probe curve for any radius of the mannequin, from a single validation.
+//
+// The radius only decides whether each tested point is valid (its distance to its equivalent mecanical point is within it),
+// the ignored points and the distances don't depend on it. compute() validates the curve once with an infinite radius and
+// sorts the distances of the tested points, then for a radius r:
+//  - the invalid points are the ones farther than r, counted by a binary search in O(log n)
+//  - with an invalid point the curve is Invalid, without any it has the status of the validation with the infinite radius
+//    (every tested point valid, so the same first and last valid points and the same length and median tests)
+// The counts and status are exactly the ones CurveComparer::isCurveValid() gives with the mannequin radius set to r.
+class RadiusSweep
+{
+    private:
+        const Mannequin*    mannequin;
+        ValidationResult    result;             // with every tested point valid
+        QVector<float>      squaredDistances;   // of the tested points, sorted
+        int                 alwaysInvalidCount; // tested points whose distance is not a number, invalid at any radius
+
+    public:
+        RadiusSweep();
+
+        void    compute( const Mannequin* mannequin, const Curve& curve );
+
+        CurveValidity::Status   statusAt( float radius ) const;
+        int     validPointsCountAt( float radius ) const;
+        int     invalidPointsCountAt( float radius ) const;
+        int     getIgnoredPointsCount() const;
+        int     getTestedPointsCount() const;
+
+        float   smallestRadiusWithoutInvalidPoints() const;
+        float   smallestValidRadius() const;
+};
+
+#endif // RADIUSSWEEP_H
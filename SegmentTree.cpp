@@ -0,0 +1,213 @@
+#include "SegmentTree.h"
+
+#include <algorithm>
+#include <cfloat>
+
+#include "DistanceKernels.h"
+
+// Orders the segments by the coordinate of their center on an axis (a + b is the center times 2)
+struct SegmentCenterLess
+{
+    int axis;
+
+    SegmentCenterLess( int axis ) : axis( axis ) {}
+
+    template<class S>
+    bool operator()( const S& s1, const S& s2 ) const
+    {
+        return s1.a[axis] + s1.b[axis] < s2.a[axis] + s2.b[axis];
+    }
+};
+
+SegmentTree::SegmentTree()
+{
+}
+
+void SegmentTree::clear()
+{
+    nodes.clear();
+    segments.clear();
+}
+
+bool SegmentTree::isEmpty() const
+{
+    return segments.isEmpty();
+}
+
+int SegmentTree::nodesCount() const
+{
+    return nodes.size();
+}
+
+// Build the tree over the segments (i, i+1) of curve
+void SegmentTree::build( const Curve& curve )
+{
+    clear();
+
+    int count = curve.size() - 1;
+    if( count < 1 )
+        return;
+
+    segments.resize( count );
+    for( int i=0; i<count; ++i )
+    {
+        Segment& segment = segments[i];
+        segment.a[0] = curve[i].x;      segment.a[1] = curve[i].y;      segment.a[2] = curve[i].z;
+        segment.b[0] = curve[i+1].x;    segment.b[1] = curve[i+1].y;    segment.b[2] = curve[i+1].z;
+        segment.index = i;
+    }
+
+    // a binary tree with leaves of at least LeafSize / 2 segments has less than 4 * count / LeafSize nodes
+    nodes.reserve( 4 * count / LeafSize + 1 );
+    nodes.resize( 1 );
+    buildNode( 0, 0, count, 0 );
+}
+
+void SegmentTree::buildNode( int node, int first, int count, int depth )
+{
+    // bounds of the segments, and of their centers to choose the axis
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    float centersMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float centersMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for( int i=first; i<first+count; ++i )
+    {
+        const Segment& segment = segments[i];
+        for( int c=0; c<3; ++c )
+        {
+            boundsMin[c] = qMin( boundsMin[c], qMin( segment.a[c], segment.b[c] ) );
+            boundsMax[c] = qMax( boundsMax[c], qMax( segment.a[c], segment.b[c] ) );
+            centersMin[c] = qMin( centersMin[c], segment.a[c] + segment.b[c] );
+            centersMax[c] = qMax( centersMax[c], segment.a[c] + segment.b[c] );
+        }
+    }
+
+    for( int c=0; c<3; ++c )
+    {
+        nodes[node].boundsMin[c] = boundsMin[c];
+        nodes[node].boundsMax[c] = boundsMax[c];
+    }
+
+    // the depth can't go over MaxDepth since each level halves the segments, it is checked anyway for the stack of findClosest()
+    if( count <= LeafSize || depth >= MaxDepth - 2 )
+    {
+        nodes[node].first = first;
+        nodes[node].count = count;
+        return;
+    }
+
+    int axis = 0;
+    for( int c=1; c<3; ++c )
+    {
+        if( centersMax[c] - centersMin[c] > centersMax[axis] - centersMin[axis] )
+            axis = c;
+    }
+
+    int half = count / 2;
+    std::nth_element( segments.begin() + first, segments.begin() + first + half, segments.begin() + first + count, SegmentCenterLess( axis ) );
+
+    int children = nodes.size();
+    nodes.resize( children + 2 );
+    nodes[node].first = children;
+    nodes[node].count = 0;
+
+    buildNode( children, first, half, depth + 1 );
+    buildNode( children + 1, first + half, count - half, depth + 1 );
+}
+
+// Squared distance from p to the box of the node, 0 inside
+float SegmentTree::boxSquaredDistance( const Node& node, const Point& p )
+{
+    float coordinates[3] = { p.x, p.y, p.z };
+    float squaredDistance = 0.0f;
+
+    for( int c=0; c<3; ++c )
+    {
+        float d = 0.0f;
+        if( coordinates[c] < node.boundsMin[c] )
+            d = node.boundsMin[c] - coordinates[c];
+        else if( coordinates[c] > node.boundsMax[c] )
+            d = coordinates[c] - node.boundsMax[c];
+        squaredDistance += d * d;
+    }
+
+    return squaredDistance;
+}
+
+// Point of the segment closest to p, and its squared distance to p
+float SegmentTree::closestOnSegment( const Segment& segment, const Point& p, Point& closest )
+{
+    float dx = segment.b[0] - segment.a[0];
+    float dy = segment.b[1] - segment.a[1];
+    float dz = segment.b[2] - segment.a[2];
+    float squaredLength = dx*dx + dy*dy + dz*dz;
+
+    float t = 0.0f;
+    if( squaredLength > 0.0f )
+    {
+        t = ( ( p.x - segment.a[0] ) * dx + ( p.y - segment.a[1] ) * dy + ( p.z - segment.a[2] ) * dz ) / squaredLength;
+        t = qBound( 0.0f, t, 1.0f );
+    }
+
+    closest = Point( segment.a[0] + dx * t, segment.a[1] + dy * t, segment.a[2] + dz * t );
+    return DistanceKernels::squaredDistance( closest, p );
+}
+
+// Return the segment closest to p (the one with the lowest index if several are as close), -1 if the tree is empty.
+// closest is the point of this segment closest to p and squaredDistance their squared distance.
+int SegmentTree::findClosest( const Point& p, Point& closest, float& squaredDistance ) const
+{
+    int best = -1;
+    squaredDistance = FLT_MAX;
+
+    if( nodes.isEmpty() )
+        return best;
+
+    int stack[MaxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while( stackSize > 0 )
+    {
+        const Node& node = nodes[stack[--stackSize]];
+
+        // farther than the closest point found, but a segment as close with a lower index would still be chosen
+        if( boxSquaredDistance( node, p ) > squaredDistance )
+            continue;
+
+        if( node.count > 0 )
+        {
+            for( int i=node.first; i<node.first+node.count; ++i )
+            {
+                Point point;
+                float d = closestOnSegment( segments[i], p, point );
+                if( d < squaredDistance || ( d == squaredDistance && segments[i].index < best ) )
+                {
+                    squaredDistance = d;
+                    closest = point;
+                    best = segments[i].index;
+                }
+            }
+        }
+        else
+        {
+            // the nearest child is pushed last, to be visited first
+            float first = boxSquaredDistance( nodes[node.first], p );
+            float second = boxSquaredDistance( nodes[node.first + 1], p );
+
+            if( first <= second )
+            {
+                stack[stackSize++] = node.first + 1;
+                stack[stackSize++] = node.first;
+            }
+            else
+            {
+                stack[stackSize++] = node.first;
+                stack[stackSize++] = node.first + 1;
+            }
+        }
+    }
+
+    return best;
+}
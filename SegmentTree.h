@@ -0,0 +1,54 @@
+#ifndef SEGMENTTREE_H
+#define SEGMENTTREE_H
+
+#include <QVector>
+
+#include "Curve.h"
+
+// Bounding volume hierarchy over the segments of a curve, to find the point of the curve closest to any point in 3d
+// in O(log n) instead of going through all the segments.
+//
+// Each node has the bounding box of its segments. The leaves have at most LeafSize segments, the other nodes have
+// 2 children that split their segments in halves along the longest axis of their centers.
+// A query goes down the nearest child first and skips the nodes farther than the closest point found so far.
+// The tree has its own copy of the segments, it doesn't depend on the curve once built.
+class SegmentTree
+{
+    private:
+        struct Node
+        {
+            float   boundsMin[3];
+            float   boundsMax[3];
+            int     first;      // leaf: first segment in segments, other node: index of its first child (the second one is next)
+            int     count;      // segments of the leaf, 0 for the other nodes
+        };
+
+        struct Segment
+        {
+            float   a[3];
+            float   b[3];
+            int     index;      // the segment (index, index + 1) of the curve
+        };
+
+        QVector<Node>       nodes;
+        QVector<Segment>    segments;   // in the order of the leaves
+
+        static const int LeafSize = 4;
+        static const int MaxDepth = 64;
+
+        void    buildNode( int node, int first, int count, int depth );
+        static float boxSquaredDistance( const Node& node, const Point& p );
+        static float closestOnSegment( const Segment& segment, const Point& p, Point& closest );
+
+    public:
+        SegmentTree();
+
+        void    build( const Curve& curve );
+        void    clear();
+        bool    isEmpty() const;
+        int     nodesCount() const;
+
+        int     findClosest( const Point& p, Point& closest, float& squaredDistance ) const;
+};
+
+#endif // SEGMENTTREE_H
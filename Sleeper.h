@@ -0,0 +1,14 @@
+#ifndef SLEEPER_H
+#define SLEEPER_H
+
+#include <QThread>
+
+// QThread::usleep() and QThread::msleep() are protected in Qt 4, to sleep in the current thread from anywhere
+class Sleeper : public QThread
+{
+    public:
+        static void usleep( unsigned long usecs ) { QThread::usleep( usecs ); }
+        static void msleep( unsigned long msecs ) { QThread::msleep( msecs ); }
+};
+
+#endif // SLEEPER_H
@@ -0,0 +1,277 @@
+#include "StageMetrics.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutexLocker>
+#include <QThreadStorage>
+#include <cstdio>
+
+#include "Log.h"
+
+volatile int StageMetrics::enabled = 0;
+
+const char* Stage::name( Id stage )
+{
+    switch( stage )
+    {
+        case IgnoreMarking:     return "ignore_marking";
+        case PointMatching:     return "point_matching";
+        case DistanceTests:     return "distance_tests";
+        case IntervalMedian:    return "interval_median";
+        case SegmentLength:     return "segment_length";
+        case CsvLoad:           return "csv_load";
+        case RecordingLoad:     return "recording_load";
+        case MannequinLoad:     return "mannequin_load";
+        default:                return "";
+    }
+}
+
+//  StageTotals
+/********************************************************************************/
+
+StageTotals::StageTotals()
+{
+    items = 0;
+}
+
+void StageTotals::add( const StageTotals& other )
+{
+    items += other.items;
+    latency.add( other.latency );
+}
+
+//  Recorders
+/********************************************************************************/
+
+// The histograms of one thread. Its mutex is only contended while a snapshot reads them,
+// when the thread ends they are added to endedThreads
+class StageRecorder
+{
+    public:
+        QMutex      mutex;
+        StageTotals stages[Stage::Count];
+
+        StageRecorder();
+        ~StageRecorder();
+};
+
+static QMutex recordersMutex;
+static QList<StageRecorder*> recorders;
+static StageTotals endedThreads[Stage::Count];
+static QThreadStorage<StageRecorder*> threadRecorder;
+
+StageRecorder::StageRecorder()
+{
+    QMutexLocker locker( &recordersMutex );
+    recorders.append( this );
+}
+
+StageRecorder::~StageRecorder()
+{
+    QMutexLocker locker( &recordersMutex );
+    recorders.removeOne( this );
+
+    for( int i=0; i<Stage::Count; ++i )
+        endedThreads[i].add( stages[i] );
+}
+
+static QElapsedTimer startedClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+static const QElapsedTimer stageClock = startedClock();
+
+//  StageMetrics
+/********************************************************************************/
+
+bool StageMetrics::isEnabled()
+{
+    return ESO_STAGES_ENABLED();
+}
+
+void StageMetrics::setEnabled( bool enabled )
+{
+    StageMetrics::enabled = enabled;
+}
+
+// Monotonic, from the start of the process
+qint64 StageMetrics::nowNsecs()
+{
+    return stageClock.nsecsElapsed();
+}
+
+void StageMetrics::record( Stage::Id stage, qint64 nsecs, qint64 items )
+{
+    if( !threadRecorder.hasLocalData() )
+        threadRecorder.setLocalData( new StageRecorder() );
+
+    StageRecorder* recorder = threadRecorder.localData();
+    QMutexLocker locker( &recorder->mutex );
+    recorder->stages[stage].items += items;
+    recorder->stages[stage].latency.record( nsecs );
+}
+
+// Totals of all the threads since the start (or the last reset())
+QVector<StageTotals> StageMetrics::snapshot()
+{
+    QVector<StageTotals> stages( Stage::Count );
+    QMutexLocker locker( &recordersMutex );
+
+    for( int i=0; i<Stage::Count; ++i )
+        stages[i].add( endedThreads[i] );
+
+    for( int r=0; r<recorders.size(); ++r )
+    {
+        QMutexLocker recorderLocker( &recorders[r]->mutex );
+        for( int i=0; i<Stage::Count; ++i )
+            stages[i].add( recorders[r]->stages[i] );
+    }
+
+    return stages;
+}
+
+void StageMetrics::reset()
+{
+    QMutexLocker locker( &recordersMutex );
+
+    for( int i=0; i<Stage::Count; ++i )
+        endedThreads[i] = StageTotals();
+
+    for( int r=0; r<recorders.size(); ++r )
+    {
+        QMutexLocker recorderLocker( &recorders[r]->mutex );
+        for( int i=0; i<Stage::Count; ++i )
+            recorders[r]->stages[i] = StageTotals();
+    }
+}
+
+// Prometheus text exposition format: a histogram of the durations and a counter of the items for each stage,
+// plus the main percentiles as gauges to read the dump without Prometheus.
+// The buckets are the ones of LatencyHistogram summed up to each bound, see LatencyHistogram::countAtMost().
+QByteArray StageMetrics::prometheusText( const QVector<StageTotals>& stages )
+{
+    static const qint64 bounds[] = { 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, Q_INT64_C( 10000000000 ) };
+    static const double quantiles[] = { 0.5, 0.9, 0.99 };
+
+    QByteArray text;
+    char line[256];
+
+    text += "# HELP eso_stage_duration_seconds Duration of the stages of the validation and of the loaders.\n";
+    text += "# TYPE eso_stage_duration_seconds histogram\n";
+    for( int i=0; i<stages.size(); ++i )
+    {
+        const char* name = Stage::name( Stage::Id( i ) );
+        const LatencyHistogram& latency = stages[i].latency;
+
+        for( size_t b=0; b<sizeof( bounds ) / sizeof( bounds[0] ); ++b )
+        {
+            qsnprintf( line, sizeof( line ), "eso_stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %lld\n",
+                       name, bounds[b] / 1e9, latency.countAtMost( bounds[b] ) );
+            text += line;
+        }
+
+        qsnprintf( line, sizeof( line ), "eso_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %lld\n", name, latency.getCount() );
+        text += line;
+        qsnprintf( line, sizeof( line ), "eso_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n", name, latency.getSum() / 1e9 );
+        text += line;
+        qsnprintf( line, sizeof( line ), "eso_stage_duration_seconds_count{stage=\"%s\"} %lld\n", name, latency.getCount() );
+        text += line;
+    }
+
+    text += "# HELP eso_stage_items_total Points (or other items) processed by the stages.\n";
+    text += "# TYPE eso_stage_items_total counter\n";
+    for( int i=0; i<stages.size(); ++i )
+    {
+        qsnprintf( line, sizeof( line ), "eso_stage_items_total{stage=\"%s\"} %lld\n", Stage::name( Stage::Id( i ) ), stages[i].items );
+        text += line;
+    }
+
+    text += "# HELP eso_stage_duration_quantile_seconds Percentiles of the duration of the stages, within 25%.\n";
+    text += "# TYPE eso_stage_duration_quantile_seconds gauge\n";
+    for( int i=0; i<stages.size(); ++i )
+    {
+        for( size_t q=0; q<sizeof( quantiles ) / sizeof( quantiles[0] ); ++q )
+        {
+            qsnprintf( line, sizeof( line ), "eso_stage_duration_quantile_seconds{stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                       Stage::name( Stage::Id( i ) ), quantiles[q], stages[i].latency.percentile( quantiles[q] ) / 1e9 );
+            text += line;
+        }
+    }
+
+    return text;
+}
+
+// Write the text of a snapshot to the file, or to stdout for "-"
+bool StageMetrics::dump( const QString& filename )
+{
+    QByteArray text = prometheusText( snapshot() );
+
+    if( filename == "-" )
+    {
+        fwrite( text.constData(), 1, text.size(), stdout );
+        fflush( stdout );
+        return true;
+    }
+
+    QString temporary = filename + ".tmp";
+    QFile file( temporary );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( text ) != text.size() )
+        return false;
+    file.close();
+
+    // QFile::rename() doesn't replace an existing file
+    QFile::remove( filename );
+    return QFile::rename( temporary, filename );
+}
+
+//  StageMetricsDumper
+/********************************************************************************/
+
+StageMetricsDumper::StageMetricsDumper( const QString& filename, int intervalMsecs ) :
+    filename( filename ), intervalMsecs( intervalMsecs )
+{
+    stopping = false;
+}
+
+StageMetricsDumper::~StageMetricsDumper()
+{
+    stop();
+    wait();
+}
+
+// The last dump is written before the thread ends
+void StageMetricsDumper::stop()
+{
+    QMutexLocker locker( &mutex );
+    stopping = true;
+    stopRequested.wakeAll();
+}
+
+void StageMetricsDumper::run()
+{
+    QMutexLocker locker( &mutex );
+    bool failed = false;
+
+    for( ;; )
+    {
+        bool last = stopping;
+        if( !last )
+        {
+            stopRequested.wait( &mutex, qMax( intervalMsecs, 1 ) );
+            last = stopping;
+        }
+
+        if( !StageMetrics::dump( filename ) && !failed )
+        {
+            ESO_LOG_WARNING << "Can't write the stage metrics to" << filename;
+            failed = true;
+        }
+
+        if( last )
+            break;
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef STAGEMETRICS_H
+#define STAGEMETRICS_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "LatencyHistogram.h"
+
+// Timings of the stages of a validation and of the loaders, to see where the time goes.
+//
+//  StageTimer timer( Stage::PointMatching, endIndex - startIndex );   // times the rest of the scope
+//
+// Each timer records its duration and its items (points, ...) in the histogram of its stage when it goes out of scope.
+// Nothing is measured until StageMetrics::setEnabled( true ): a disabled timer only reads a flag.
+// With DEFINES += ESO_STAGES_COMPILED=0 the flag is false at compile time and the timers are removed by the compiler.
+//
+// Each thread records in its own histograms, StageMetrics::snapshot() adds those of all the threads (even the ended ones).
+namespace Stage
+{
+    enum Id
+    {
+        IgnoreMarking = 0,      // CurveComparer::setIgnoredPoints()
+        PointMatching = 1,      // CurveComparer::findEquivalentPoints(), either matching
+        DistanceTests = 2,      // verdicts of the matched points in CurveComparer::isCurveValid()
+        IntervalMedian = 3,     // CurveComparer::findIntervalStatistics()
+        SegmentLength = 4,      // CurveComparer::segmentLength()
+        CsvLoad = 5,            // ProbeCurveLoader::load()
+        RecordingLoad = 6,      // ProbeRecordingReader::load()
+        MannequinLoad = 7,      // Mannequin::loadMannequin()
+        Count = 8
+    };
+
+    const char* name( Id stage );
+}
+
+// Totals of one stage
+struct StageTotals
+{
+    qint64              items;
+    LatencyHistogram    latency;    // one value per timer (call), in ns
+
+    StageTotals();
+    void    add( const StageTotals& other );
+};
+
+namespace StageMetrics
+{
+    bool    isEnabled();
+    void    setEnabled( bool enabled );
+
+    // read without a lock like Log::currentLevel, the timers already started when it changes are recorded or not
+    extern volatile int enabled;
+
+    qint64  nowNsecs();
+    void    record( Stage::Id stage, qint64 nsecs, qint64 items );
+
+    QVector<StageTotals>    snapshot();     // indexed by Stage::Id
+    void                    reset();
+
+    QByteArray  prometheusText( const QVector<StageTotals>& stages );
+    bool        dump( const QString& filename );    // "-" for stdout
+}
+
+#ifndef ESO_STAGES_COMPILED
+#define ESO_STAGES_COMPILED 1
+#endif
+
+#define ESO_STAGES_ENABLED() ( ESO_STAGES_COMPILED && StageMetrics::enabled )
+
+// Inline so a disabled timer costs a test of the flag, and nothing at all when the stages are not compiled
+class StageTimer
+{
+    private:
+        Stage::Id   stage;
+        qint64      items;
+        qint64      startNsecs;     // -1 when disabled
+
+        Q_DISABLE_COPY( StageTimer )
+
+    public:
+        StageTimer( Stage::Id stage, qint64 items = 1 ) : stage( stage ), items( items )
+        {
+            startNsecs = ESO_STAGES_ENABLED() ? StageMetrics::nowNsecs() : -1;
+        }
+
+        ~StageTimer()
+        {
+            if( ESO_STAGES_COMPILED && startNsecs >= 0 )
+                StageMetrics::record( stage, StageMetrics::nowNsecs() - startNsecs, items );
+        }
+
+        // when the items are only known at the end (ex. the points of a file)
+        void    setItems( qint64 items ) { this->items = items; }
+};
+
+// Write StageMetrics::prometheusText() to a file (or stdout) every intervalMsecs, and once more when stopped.
+// The file is written next to it then renamed, so a reader (ex. the textfile collector of node_exporter) never sees half of it.
+class StageMetricsDumper : public QThread
+{
+    private:
+        QString         filename;
+        int             intervalMsecs;
+        QMutex          mutex;
+        QWaitCondition  stopRequested;
+        bool            stopping;
+
+    protected:
+        void    run();
+
+    public:
+        StageMetricsDumper( const QString& filename, int intervalMsecs );
+        ~StageMetricsDumper();
+
+        void    stop();
+};
+
+#endif // STAGEMETRICS_H
@@ -0,0 +1,283 @@
+#include "TrackerPipeline.h"
+
+#include <QMutexLocker>
+
+#include "Log.h"
+#include "Sleeper.h"
+
+//  SampleRing
+/********************************************************************************/
+
+// The capacity is rounded up to a power of 2
+SampleRing::SampleRing( int capacity )
+{
+    int size = 2;
+    while( size < capacity )
+        size *= 2;
+
+    samples.resize( size );
+    mask = size - 1;
+}
+
+// Producer thread only, false if the ring is full
+bool SampleRing::push( const TrackerSample& sample )
+{
+    int h = head;
+    int t = tail.fetchAndAddAcquire( 0 );
+    if( quint32( h ) - quint32( t ) > quint32( mask ) )
+        return false;
+
+    samples[h & mask] = sample;
+    head.fetchAndStoreRelease( int( quint32( h ) + 1 ) );
+    return true;
+}
+
+// Consumer thread only, return the samples popped (at most maxCount, 0 if the ring is empty)
+int SampleRing::pop( TrackerSample* out, int maxCount )
+{
+    int t = tail;
+    int h = head.fetchAndAddAcquire( 0 );
+    int count = qMin( int( quint32( h ) - quint32( t ) ), maxCount );
+
+    for( int i=0; i<count; ++i )
+        out[i] = samples[( quint32( t ) + i ) & mask];
+
+    tail.fetchAndStoreRelease( int( quint32( t ) + count ) );
+    return count;
+}
+
+// Samples waiting, from any thread (it may be already out of date)
+int SampleRing::size()
+{
+    int t = tail.fetchAndAddAcquire( 0 );
+    int h = head.fetchAndAddAcquire( 0 );
+    return int( qMin( quint32( h ) - quint32( t ), quint32( mask + 1 ) ) );
+}
+
+int SampleRing::capacity() const
+{
+    return mask + 1;
+}
+
+//  Threads
+/********************************************************************************/
+
+TrackerAcquisition::TrackerAcquisition( TrackerPipeline* pipeline ) : pipeline( pipeline )
+{
+}
+
+void TrackerAcquisition::run()
+{
+    pipeline->acquire();
+}
+
+TrackerConsumer::TrackerConsumer( TrackerPipeline* pipeline ) : pipeline( pipeline )
+{
+}
+
+void TrackerConsumer::run()
+{
+    pipeline->consume();
+}
+
+//  TrackerMetrics
+/********************************************************************************/
+
+TrackerMetrics::TrackerMetrics()
+{
+    ringCapacity = 0;
+    ringOccupancy = 0;
+    maxRingOccupancy = 0;
+    receivedCount = 0;
+    droppedCount = 0;
+    validatedCount = 0;
+    batchesCount = 0;
+    sourceEnded = false;
+    status = CurveValidity::NotTested;
+    validPointsCount = 0;
+    invalidPointsCount = 0;
+    ignoredPointsCount = 0;
+    attemptsCount = 0;
+    validAttemptsCount = 0;
+    invalidAttemptsCount = 0;
+}
+
+//  TrackerPipeline
+/********************************************************************************/
+
+TrackerPipeline::TrackerPipeline( TrackerSource* source, const Mannequin* mannequin, int ringCapacity ) :
+    source( source ), ring( ringCapacity ), session( mannequin ), acquisition( this ), consumer( this )
+{
+    metrics.ringCapacity = ring.capacity();
+}
+
+TrackerPipeline::~TrackerPipeline()
+{
+    stop();
+    wait();
+    delete source;
+}
+
+void TrackerPipeline::start()
+{
+    clock.start();
+    acquisition.start();
+    consumer.start();
+}
+
+// Stop reading the source, the samples already in the ring are still validated
+void TrackerPipeline::stop()
+{
+    stopping.fetchAndStoreRelease( 1 );
+}
+
+// Wait for the end of both threads, after stop() or the end of the source
+bool TrackerPipeline::wait( unsigned long msecs )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if( !acquisition.wait( msecs ) )
+        return false;
+
+    if( msecs == ULONG_MAX )
+        return consumer.wait();
+
+    qint64 left = qint64( msecs ) - timer.elapsed();
+    return consumer.wait( left > 0 ? left : 0 );
+}
+
+bool TrackerPipeline::isFinished()
+{
+    return acquisition.isFinished() && consumer.isFinished();
+}
+
+// Acquisition thread
+void TrackerPipeline::acquire()
+{
+    if( !source->open() )
+    {
+        sourceEnded.fetchAndStoreRelease( 1 );
+        return;
+    }
+
+    Point points[BatchSize];
+    qint64 receivedCount = 0;
+    qint64 droppedCount = 0;
+    bool newAttempt = false;    // kept until a sample gets in the ring, so the session starts over even after drops
+
+    while( !stopping.fetchAndAddAcquire( 0 ) )
+    {
+        int count = source->read( points, BatchSize, ReadTimeoutMsecs );
+        if( count < 0 )
+            break;
+
+        if( count > 0 && source->startsNewAttempt() )
+            newAttempt = true;
+
+        qint64 arrival = clock.nsecsElapsed();
+        for( int i=0; i<count; ++i )
+        {
+            TrackerSample sample;
+            sample.point = points[i];
+            sample.arrivalNsecs = arrival;
+            sample.newAttempt = newAttempt;
+
+            if( ring.push( sample ) )
+                newAttempt = false;
+            else
+                droppedCount++;
+        }
+        receivedCount += count;
+
+        QMutexLocker locker( &metricsMutex );
+        metrics.receivedCount = receivedCount;
+        metrics.droppedCount = droppedCount;
+    }
+
+    source->close();
+    sourceEnded.fetchAndStoreRelease( 1 );
+}
+
+// Consumer thread
+void TrackerPipeline::consume()
+{
+    TrackerSample samples[BatchSize];
+    LatencyHistogram latency;
+    qint64 attemptsCount = 0;
+    qint64 validAttemptsCount = 0;
+    qint64 invalidAttemptsCount = 0;
+
+    for( ;; )
+    {
+        // read before popping: once the source has ended, an empty ring stays empty
+        bool ended = sourceEnded.fetchAndAddAcquire( 0 );
+        int occupancy = ring.size();
+        int count = ring.pop( samples, BatchSize );
+
+        if( count == 0 )
+        {
+            if( ended )
+                break;
+            Sleeper::usleep( IdleSleepUsecs );
+            continue;
+        }
+
+        for( int i=0; i<count; ++i )
+        {
+            if( samples[i].newAttempt && !session.getProbeCurve().isEmpty() )
+            {
+                CurveValidity::Status status = session.currentStatus();
+                attemptsCount++;
+                if( status == CurveValidity::Valid )
+                    validAttemptsCount++;
+                else if( status == CurveValidity::Invalid )
+                    invalidAttemptsCount++;
+                session.reset();
+            }
+            session.pushPoint( samples[i].point );
+        }
+
+        // the verdicts of the whole batch are known now
+        qint64 now = clock.nsecsElapsed();
+        latency.clear();
+        for( int i=0; i<count; ++i )
+            latency.record( now - samples[i].arrivalNsecs );
+
+        CurveValidity::Status status = session.currentStatus();
+
+        QMutexLocker locker( &metricsMutex );
+        metrics.maxRingOccupancy = qMax( metrics.maxRingOccupancy, occupancy );
+        metrics.validatedCount += count;
+        metrics.batchesCount++;
+        metrics.latency.add( latency );
+        metrics.status = status;
+        metrics.validPointsCount = session.getValidPointsCount();
+        metrics.invalidPointsCount = session.getInvalidPointsCount();
+        metrics.ignoredPointsCount = session.getIgnoredPointsCount();
+        metrics.attemptsCount = attemptsCount;
+        metrics.validAttemptsCount = validAttemptsCount;
+        metrics.invalidAttemptsCount = invalidAttemptsCount;
+    }
+
+    ESO_LOG_DEBUG << "Tracker pipeline done:" << session.getProbeCurve().size() << "points validated";
+}
+
+// Copy of the metrics, from any thread
+TrackerMetrics TrackerPipeline::getMetrics()
+{
+    TrackerMetrics copy;
+    {
+        QMutexLocker locker( &metricsMutex );
+        copy = metrics;
+    }
+
+    copy.ringOccupancy = ring.size();
+    copy.sourceEnded = sourceEnded.fetchAndAddAcquire( 0 );
+    return copy;
+}
+
+const TrackerSource* TrackerPipeline::getSource() const
+{
+    return source;
+}
@@ -0,0 +1,155 @@
+#ifndef TRACKERPIPELINE_H
+#define TRACKERPIPELINE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QVector>
+#include <climits>
+
+#include "LatencyHistogram.h"
+#include "TrackerSource.h"
+#include "ValidationSession.h"
+
+// A probe point with the time it was received, in ns on the clock of the pipeline
+struct TrackerSample
+{
+    Point   point;
+    qint64  arrivalNsecs;
+    bool    newAttempt;         // the session starts over with this point
+};
+
+// Lock-free ring of samples between one producer thread (push) and one consumer thread (pop).
+// head is only written by the producer and tail by the consumer, each one publishes its writes with a release store
+// and reads the other one with an acquire load, so a sample is always complete when it is popped.
+// The counters run freely, their difference is the occupancy (the capacity is a power of 2). They are computed
+// as quint32 so they wrap around after 2^32 samples.
+class SampleRing
+{
+    private:
+        QVector<TrackerSample>  samples;
+        int                     mask;
+        QAtomicInt              head;           // next sample pushed
+        char                    padding[64];    // head and tail on different cache lines
+        QAtomicInt              tail;           // next sample popped
+
+        Q_DISABLE_COPY( SampleRing )
+
+    public:
+        SampleRing( int capacity );
+
+        bool    push( const TrackerSample& sample );
+        int     pop( TrackerSample* out, int maxCount );
+
+        int     size();
+        int     capacity() const;
+};
+
+class TrackerPipeline;
+
+// Reads the source and pushes its points in the ring, the samples that don't fit are dropped
+class TrackerAcquisition : public QThread
+{
+    private:
+        TrackerPipeline*    pipeline;
+
+    protected:
+        void    run();
+
+    public:
+        TrackerAcquisition( TrackerPipeline* pipeline );
+};
+
+// Pops the samples from the ring by batches and validates them in the session
+class TrackerConsumer : public QThread
+{
+    private:
+        TrackerPipeline*    pipeline;
+
+    protected:
+        void    run();
+
+    public:
+        TrackerConsumer( TrackerPipeline* pipeline );
+};
+
+// State of a pipeline at one time, see TrackerPipeline::getMetrics()
+struct TrackerMetrics
+{
+    int     ringCapacity;
+    int     ringOccupancy;          // samples waiting to be validated
+    int     maxRingOccupancy;       // since start()
+    qint64  receivedCount;          // samples read from the source
+    qint64  droppedCount;           // samples lost because the ring was full
+    qint64  validatedCount;
+    qint64  batchesCount;
+    bool    sourceEnded;            // the source has no more samples (or couldn't be opened)
+
+    LatencyHistogram        latency;    // from the arrival of each sample to its verdict, in ns
+    CurveValidity::Status   status;     // of the samples of the current attempt
+    int     validPointsCount;
+    int     invalidPointsCount;
+    int     ignoredPointsCount;
+
+    // attempts finished (see TrackerSource::startsNewAttempt()), the current one is not counted
+    qint64  attemptsCount;
+    qint64  validAttemptsCount;
+    qint64  invalidAttemptsCount;
+
+    TrackerMetrics();
+};
+
+// Live validation of the points of a tracker:
+//
+//  source --(acquisition thread)--> SampleRing --(consumer thread)--> ValidationSession
+//
+// The acquisition thread only reads the source and stamps the samples, it never waits for the validation: when the
+// consumer is too slow the ring fills up and the new samples are dropped (and counted), the tracker is never slowed down.
+// The consumer takes all the samples waiting, up to BatchSize, and validates them one by one in the session,
+// the latency of each sample is measured when its batch is done. The session starts over at each new attempt of the source.
+//
+// The pipeline owns the source. The mannequin must not be modified while the pipeline runs.
+class TrackerPipeline
+{
+    friend class TrackerAcquisition;
+    friend class TrackerConsumer;
+
+    public:
+        static const int BatchSize = 64;
+        static const int ReadTimeoutMsecs = 50;     // the acquisition looks at stop() at least this often
+        static const int IdleSleepUsecs = 200;      // the consumer sleeps this long when the ring is empty
+
+    private:
+        TrackerSource*      source;
+        SampleRing          ring;
+        ValidationSession   session;                // only used by the consumer thread
+        TrackerAcquisition  acquisition;
+        TrackerConsumer     consumer;
+        QElapsedTimer       clock;
+
+        QAtomicInt          stopping;
+        QAtomicInt          sourceEnded;
+        // written by the consumer after each batch, and the received and dropped counts by the acquisition thread
+        QMutex              metricsMutex;
+        TrackerMetrics      metrics;
+
+        void    acquire();
+        void    consume();
+
+        Q_DISABLE_COPY( TrackerPipeline )
+
+    public:
+        TrackerPipeline( TrackerSource* source, const Mannequin* mannequin, int ringCapacity = 4096 );
+        ~TrackerPipeline();
+
+        void    start();
+        void    stop();
+        bool    wait( unsigned long msecs = ULONG_MAX );
+        bool    isFinished();
+
+        TrackerMetrics  getMetrics();
+        const TrackerSource* getSource() const;
+};
+
+#endif // TRACKERPIPELINE_H
@@ -0,0 +1,273 @@
+#include "TrackerSource.h"
+
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <cstring>
+#include <cmath>
+
+#include "Log.h"
+#include "ProbeCurveLoader.h"
+#include "Sleeper.h"
+
+TrackerSource::~TrackerSource()
+{
+}
+
+bool TrackerSource::startsNewAttempt() const
+{
+    return false;
+}
+
+//  CsvReplaySource
+/********************************************************************************/
+
+CsvReplaySource::CsvReplaySource( const QString& filename, double rate, double speed, bool loop ) :
+    filename( filename ), rate( rate ), speed( speed ), loop( loop )
+{
+    jitterMsecs = 0.0;
+    noise = 0.0f;
+    seed = 12345;
+
+    nextPoint = 0;
+    nextDueNsecs = 0;
+    newAttempt = false;
+    random = seed;
+}
+
+// Only before open()
+void CsvReplaySource::setJitter( double msecs )
+{
+    jitterMsecs = qMax( msecs, 0.0 );
+}
+
+void CsvReplaySource::setNoise( float standardDeviation )
+{
+    noise = qMax( standardDeviation, 0.0f );
+}
+
+void CsvReplaySource::setSeed( quint32 seed )
+{
+    this->seed = seed;
+}
+
+bool CsvReplaySource::open()
+{
+    nextPoint = 0;
+    nextDueNsecs = 0;
+    newAttempt = false;
+    random = seed;
+
+    if( !ProbeCurveLoader::load( filename, curve ) || curve.isEmpty() )
+    {
+        ESO_LOG_WARNING << "Can't replay" << filename;
+        return false;
+    }
+
+    scheduleNextPoint();
+    clock.start();
+    return true;
+}
+
+void CsvReplaySource::close()
+{
+    curve.clear();
+}
+
+int CsvReplaySource::read( Point* points, int maxCount, int timeoutMsecs )
+{
+    newAttempt = false;
+    if( curve.isEmpty() || ( !loop && nextPoint >= curve.size() ) )
+        return -1;
+
+    // without a speed all the points are due
+    qint64 now = 0;
+    if( speed > 0.0 )
+    {
+        // wait for the next point if it's not due yet, but no more than the timeout
+        qint64 waitNsecs = nextDueNsecs - clock.nsecsElapsed();
+        if( waitNsecs > 0 )
+        {
+            if( waitNsecs > timeoutMsecs * Q_INT64_C( 1000000 ) )
+            {
+                Sleeper::usleep( timeoutMsecs * 1000 );
+                return 0;
+            }
+            Sleeper::usleep( ( waitNsecs + 999 ) / 1000 );
+        }
+
+        now = clock.nsecsElapsed();
+    }
+
+    int count = 0;
+    while( count < maxCount && ( speed <= 0.0 || nextDueNsecs <= now ) )
+    {
+        int index = int( nextPoint % curve.size() );
+        if( nextPoint > 0 && index == 0 )
+        {
+            // end of the recording, or of an attempt: the next one starts with the next read
+            if( !loop || count > 0 )
+                break;
+            newAttempt = true;
+        }
+
+        const Point& point = curve[index];
+        if( noise > 0.0f )
+            points[count++] = Point( point.x + noise * nextGaussian(), point.y + noise * nextGaussian(), point.z + noise * nextGaussian() );
+        else
+            points[count++] = point;
+
+        nextPoint++;
+        scheduleNextPoint();
+    }
+
+    return count;
+}
+
+// The time of nextPoint in the recording, plus its jitter, but never before the previous point
+void CsvReplaySource::scheduleNextPoint()
+{
+    if( speed <= 0.0 )
+        return;
+
+    qint64 due = qint64( nextPoint / ( rate * speed ) * 1e9 );
+    if( jitterMsecs > 0.0 )
+        due += qint64( nextUniform() * jitterMsecs * 1e6 / speed );
+
+    nextDueNsecs = qMax( nextDueNsecs, due );
+}
+
+// In [0, 1), same generator as the synthetic curves of the benchmark
+double CsvReplaySource::nextUniform()
+{
+    random = random * 1664525u + 1013904223u;
+    return ( random >> 8 ) / 16777216.0;
+}
+
+// Standard normal distribution (Box-Muller)
+float CsvReplaySource::nextGaussian()
+{
+    double u = 1.0 - nextUniform();
+    double v = nextUniform();
+    return float( sqrt( -2.0 * log( u ) ) * cos( 6.283185307179586 * v ) );
+}
+
+bool CsvReplaySource::startsNewAttempt() const
+{
+    return newAttempt;
+}
+
+QString CsvReplaySource::description() const
+{
+    QString text = QString( "replay of %1 at %2 points/s x%3%4" ).arg( filename ).arg( rate ).arg( speed ).arg( loop ? ", looped" : "" );
+    if( jitterMsecs > 0.0 )
+        text += QString( ", jitter %1 ms" ).arg( jitterMsecs );
+    if( noise > 0.0f )
+        text += QString( ", noise %1 mm" ).arg( noise );
+    return text;
+}
+
+// Points of the recording, once opened
+int CsvReplaySource::size() const
+{
+    return curve.size();
+}
+
+//  UdpTrackerSource
+/********************************************************************************/
+
+UdpTrackerSource::UdpTrackerSource( quint16 port ) : port( port )
+{
+    socket = 0;
+    backlogIndex = 0;
+    rejectedLinesCount = 0;
+}
+
+UdpTrackerSource::~UdpTrackerSource()
+{
+    delete socket;
+}
+
+// Only the local interface is listened to, the tracker service runs on the same host
+bool UdpTrackerSource::open()
+{
+    delete socket;
+    socket = new QUdpSocket();
+    backlog.clear();
+    backlogIndex = 0;
+
+    if( !socket->bind( QHostAddress( QHostAddress::LocalHost ), port ) )
+    {
+        ESO_LOG_WARNING << "Can't listen to the udp port" << port;
+        return false;
+    }
+
+    return true;
+}
+
+void UdpTrackerSource::close()
+{
+    delete socket;
+    socket = 0;
+}
+
+int UdpTrackerSource::read( Point* points, int maxCount, int timeoutMsecs )
+{
+    if( socket == 0 )
+        return -1;
+
+    if( backlogIndex >= backlog.size() )
+    {
+        backlog.resize( 0 );
+        backlogIndex = 0;
+
+        if( !socket->hasPendingDatagrams() && !socket->waitForReadyRead( timeoutMsecs ) )
+            return 0;
+        readDatagrams();
+    }
+
+    int count = qMin( maxCount, backlog.size() - backlogIndex );
+    for( int i=0; i<count; ++i )
+        points[i] = backlog[backlogIndex++];
+
+    return count;
+}
+
+// Parse the datagrams waiting on the socket, their points go to the backlog
+void UdpTrackerSource::readDatagrams()
+{
+    while( socket->hasPendingDatagrams() )
+    {
+        datagram.resize( int( socket->pendingDatagramSize() ) );
+        qint64 size = socket->readDatagram( datagram.data(), datagram.size() );
+        if( size <= 0 )
+            continue;
+
+        const char* p = datagram.constData();
+        const char* end = p + size;
+        while( p < end )
+        {
+            const char* lineEnd = static_cast<const char*>( memchr( p, '\n', end - p ) );
+            if( lineEnd == 0 )
+                lineEnd = end;
+
+            Point point;
+            if( ProbeCurveLoader::parsePoint( p, lineEnd, point ) )
+                backlog.append( point );
+            else if( lineEnd > p && !( lineEnd - p == 1 && *p == '\r' ) )
+                rejectedLinesCount++;
+
+            p = lineEnd + 1;
+        }
+    }
+}
+
+QString UdpTrackerSource::description() const
+{
+    return QString( "udp port %1" ).arg( port );
+}
+
+// Lines of the datagrams that were not points, since the source was created
+qint64 UdpTrackerSource::getRejectedLinesCount() const
+{
+    return rejectedLinesCount;
+}
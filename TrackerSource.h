@@ -0,0 +1,104 @@
+#ifndef TRACKERSOURCE_H
+#define TRACKERSOURCE_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+#include "Curve.h"
+
+class QUdpSocket;
+
+// Where the probe points of a TrackerPipeline come from (the magnetic tracker, a replayed recording, ...).
+// All the methods are called from the acquisition thread of the pipeline, open() first.
+class TrackerSource
+{
+    public:
+        virtual ~TrackerSource();
+
+        virtual bool    open() = 0;
+        virtual void    close() = 0;
+
+        // Wait up to timeoutMsecs for points and return how many were put in points (at most maxCount),
+        // 0 if none came in time, -1 when the source has ended (end of the recording, socket error, ...)
+        virtual int     read( Point* points, int maxCount, int timeoutMsecs ) = 0;
+
+        // True when the points of the last read() start a new attempt of the trainee, the validation starts over
+        // with them (a read() never gives the points of two attempts). Never by default.
+        virtual bool    startsNewAttempt() const;
+
+        virtual QString description() const = 0;
+};
+
+// Replay the points of a csv file at the rate of the tracker, as a stand-in for the tracker in tests.
+// The point i is given at i / ( rate * speed ) seconds from open(): speed 1 is real time, 10 is 10 times faster,
+// 0 gives all the points at once. With loop, the recording starts over at its end and never ends, each pass is
+// a new attempt.
+// To look like a real tracker, each point can be delayed by a random time up to the jitter (the points stay in order,
+// a late point holds back the next ones) and moved by a gaussian noise on x, y and z. The random sequence only
+// depends on the seed, so two replays with the same seed give the same points.
+class CsvReplaySource : public TrackerSource
+{
+    private:
+        QString         filename;
+        double          rate;           // points per second of the recording
+        double          speed;
+        bool            loop;
+        double          jitterMsecs;    // of the recording, divided by the speed like the rest of the timing
+        float           noise;          // standard deviation, in mm
+        quint32         seed;
+
+        Curve           curve;
+        qint64          nextPoint;      // points given since open(), more than the curve size with loop
+        qint64          nextDueNsecs;   // when nextPoint is given, since open()
+        bool            newAttempt;
+        quint32         random;
+        QElapsedTimer   clock;
+
+        void    scheduleNextPoint();
+        double  nextUniform();
+        float   nextGaussian();
+
+    public:
+        CsvReplaySource( const QString& filename, double rate = 240.0, double speed = 1.0, bool loop = false );
+
+        void    setJitter( double msecs );
+        void    setNoise( float standardDeviation );
+        void    setSeed( quint32 seed );
+
+        bool    open();
+        void    close();
+        int     read( Point* points, int maxCount, int timeoutMsecs );
+        bool    startsNewAttempt() const;
+        QString description() const;
+
+        int     size() const;
+};
+
+// Receive the points from the tracker as udp datagrams on the local interface, one "x;y;z" line per point
+// (several lines per datagram are allowed). The lines that are not points are counted and skipped.
+class UdpTrackerSource : public TrackerSource
+{
+    private:
+        quint16         port;
+        QUdpSocket*     socket;         // created by open(), in the acquisition thread that reads it
+        QByteArray      datagram;
+        QVector<Point>  backlog;        // points received but not given yet (the datagram had more than maxCount)
+        int             backlogIndex;
+        qint64          rejectedLinesCount;
+
+        void    readDatagrams();
+
+    public:
+        UdpTrackerSource( quint16 port );
+        ~UdpTrackerSource();
+
+        bool    open();
+        void    close();
+        int     read( Point* points, int maxCount, int timeoutMsecs );
+        QString description() const;
+
+        qint64  getRejectedLinesCount() const;
+};
+
+#endif // TRACKERSOURCE_H
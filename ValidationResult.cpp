@@ -0,0 +1,146 @@
+#include "ValidationResult.h"
+
+// Name of the status, as written in the logs and the batch results
+const char* CurveValidity::name( Status status )
+{
+    switch( status )
+    {
+        case NotTested:             return "NotTested";
+        case Valid:                 return "Valid";
+        case Invalid:               return "Invalid";
+        case NotEnoughDataLength:   return "NotEnoughDataLength";
+        case NotEnoughDataPoints:   return "NotEnoughDataPoints";
+        case MannequinUnavailable:  return "MannequinUnavailable";
+        default:                    return "";
+    }
+}
+
+// Name of the verdict of a point, as written in the golden files of the regression tests
+const char* PointValidity::name( Status status )
+{
+    switch( status )
+    {
+        case NotTested: return "NotTested";
+        case Valid:     return "Valid";
+        case Invalid:   return "Invalid";
+        case Ignored:   return "Ignored";
+        default:        return "";
+    }
+}
+
+ValidationResult::ValidationResult()
+{
+    clear( 0, 0 );
+}
+
+// Reset the result before a new validation, the buffers keep their memory
+void ValidationResult::clear( const Mannequin* mannequin, int pointsCount )
+{
+    this->mannequin = mannequin;
+    status = CurveValidity::NotTested;
+    verdicts.fill( PointValidity::NotTested, pointsCount );
+
+    validPointsCount = 0;
+    invalidPointsCount = 0;
+    ignoredPointsCount = 0;
+    ambiguousPointsCount = 0;
+    firstValidPointIndex = -1;
+    lastValidPointIndex = -1;
+
+    intervalStatistics = IntervalStatistics();
+    mecanicalLength = 0.0f;
+    validSegmentLength = 0.0f;
+
+    trace.clear();
+}
+
+// Keep the decisions of the last capacity points of each validation (0 to disable it), see ValidationTrace
+void ValidationResult::setTraceCapacity( int capacity )
+{
+    trace.setCapacity( capacity );
+}
+
+//  Accessors
+/********************************************************************************/
+
+const Mannequin* ValidationResult::getMannequin() const
+{
+    return mannequin;
+}
+
+CurveValidity::Status ValidationResult::getStatus() const
+{
+    return status;
+}
+
+const QVector<PointValidity::Status>& ValidationResult::getVerdicts() const
+{
+    return verdicts;
+}
+
+PointValidity::Status ValidationResult::getVerdict( int i ) const
+{
+    return verdicts[i];
+}
+
+// Squared distance between the point i and its equivalent mecanical point, meaningless for the ignored points
+float ValidationResult::getSquaredDistance( int i ) const
+{
+    return squaredDistances[i];
+}
+
+int ValidationResult::size() const
+{
+    return verdicts.size();
+}
+
+int ValidationResult::getValidPointsCount() const
+{
+    return validPointsCount;
+}
+
+int ValidationResult::getInvalidPointsCount() const
+{
+    return invalidPointsCount;
+}
+
+int ValidationResult::getIgnoredPointsCount() const
+{
+    return ignoredPointsCount;
+}
+
+// Number of points compared to a part of the mecanical curve that is not monotonic in y
+int ValidationResult::getAmbiguousPointsCount() const
+{
+    return ambiguousPointsCount;
+}
+
+int ValidationResult::getFirstValidPointIndex() const
+{
+    return firstValidPointIndex;
+}
+
+int ValidationResult::getLastValidPointIndex() const
+{
+    return lastValidPointIndex;
+}
+
+IntervalStatistics ValidationResult::getIntervalStatistics() const
+{
+    return intervalStatistics;
+}
+
+float ValidationResult::getMecanicalLength() const
+{
+    return mecanicalLength;
+}
+
+float ValidationResult::getValidSegmentLength() const
+{
+    return validSegmentLength;
+}
+
+const ValidationTrace& ValidationResult::getTrace() const
+{
+    return trace;
+}
@@ -0,0 +1,89 @@
+#ifndef VALIDATIONRESULT_H
+#define VALIDATIONRESULT_H
+
+#include <vector>
+#include <QVector>
+
+#include "Mannequin.h"
+#include "IntervalStatistics.h"
+#include "ValidationTrace.h"
+
+namespace CurveValidity
+{
+    enum Status
+    {
+        NotTested = 0,
+        Valid = 1,
+        Invalid = 2,
+        NotEnoughDataLength = 3,
+        NotEnoughDataPoints = 4,
+        MannequinUnavailable = 5
+    };
+
+    const char* name( Status status );
+}
+
+namespace PointValidity
+{
+    const char* name( Status status );
+}
+
+// Result of CurveComparer::isCurveValid(): the validity of each probe point and the summary of the curve.
+// The probe curve itself is never modified by the validation.
+// A result can be given again to isCurveValid() to reuse its memory for the next validation.
+class ValidationResult
+{
+    friend class CurveComparer;
+
+    private:
+        const Mannequin*                mannequin;
+        CurveValidity::Status           status;
+        QVector<PointValidity::Status>  verdicts;
+
+        int     validPointsCount;
+        int     invalidPointsCount;
+        int     ignoredPointsCount;
+        int     ambiguousPointsCount;
+        int     firstValidPointIndex;
+        int     lastValidPointIndex;
+
+        IntervalStatistics  intervalStatistics;
+        float               mecanicalLength;
+        float               validSegmentLength;
+
+        ValidationTrace     trace;              // decisions of the last points, when enabled
+
+        // buffers reused from one validation to the other
+        std::vector<float>  intervals;          // distances between the probe points, for findIntervalStatistics()
+        std::vector<float>  lengths;            // segment lengths, for segmentLength()
+        std::vector<int>    pointAfterIndexes;  // mecanical segment of each probe point, for findEquivalentPoints()
+        std::vector<Point>  matchedPoints;      // equivalent mecanical point of each probe point
+        std::vector<float>  squaredDistances;   // squared distance between each probe point and its equivalent
+
+        void    clear( const Mannequin* mannequin, int pointsCount );
+
+    public:
+        ValidationResult();
+
+        void    setTraceCapacity( int capacity );
+
+        // accessors
+        const Mannequin*        getMannequin() const;
+        CurveValidity::Status   getStatus() const;
+        const QVector<PointValidity::Status>& getVerdicts() const;
+        PointValidity::Status   getVerdict( int i ) const;
+        float                   getSquaredDistance( int i ) const;
+        int                     size() const;
+        int                     getValidPointsCount() const;
+        int                     getInvalidPointsCount() const;
+        int                     getIgnoredPointsCount() const;
+        int                     getAmbiguousPointsCount() const;
+        int                     getFirstValidPointIndex() const;
+        int                     getLastValidPointIndex() const;
+        IntervalStatistics      getIntervalStatistics() const;
+        float                   getMecanicalLength() const;
+        float                   getValidSegmentLength() const;
+        const ValidationTrace&  getTrace() const;
+};
+
+#endif // VALIDATIONRESULT_H
@@ -0,0 +1,221 @@
+#include "ValidationSession.h"
+
+ValidationSession::ValidationSession( const Mannequin* mannequin )
+{
+    this->mannequin = mannequin;
+    reset();
+}
+
+// Forget all the probe points received and start over with the same mannequin
+void ValidationSession::reset()
+{
+    probeCurve.clear();
+
+    cursor = 1;
+    mecanicalLength = 0.0f;
+    maxYReached = false;
+
+    validPointsCount = 0;
+    invalidPointsCount = 0;
+    ignoredPointsCount = 0;
+    ambiguousPointsCount = 0;
+    firstValidPointIndex = -1;
+    lastValidPointIndex = -1;
+
+    validSegmentLength = 0.0f;
+    validSegmentEndIndex = 0;
+
+    intervals.clear();
+    intervalsEndIndex = 0;
+
+    if( mannequin == 0 )
+        return;
+
+    // calculated once when the mannequin is loaded
+    mecanicalLength = mannequin->getLength();
+}
+
+// Test a new probe point, the same way isCurveValid() tests each point of the curve.
+// Returns the validity of the point.
+PointValidity::Status ValidationSession::pushPoint( const Point& point )
+{
+    int i = probeCurve.size();
+    probeCurve.append( point );
+
+    if( mannequin == 0 )
+    {
+        probeCurve[i].validity = PointValidity::NotTested;
+        return PointValidity::NotTested;
+    }
+
+    Point& probePoint = probeCurve[i];
+
+    // same rules as CurveComparer::setIgnoredPoints():
+    // points below the first mecanical point (except the first one) and all the points from the first one above maxY are ignored
+    if( probePoint.y > mannequin->getMaxY() )
+        maxYReached = true;
+
+    if( maxYReached || ( i > 0 && probePoint.y < mannequin->at(0).y ) )
+    {
+        probePoint.validity = PointValidity::Ignored;
+        ignoredPointsCount++;
+    }
+    else
+    {
+        // the first point is compared to the endOfStomach point
+        Point mecanicalPoint = ( i == 0 ) ? mannequin->getEndOfStomach() : findEquivalentPoint( probePoint );
+
+        float dist = CurveComparer::distanceBetween2Points( mecanicalPoint, probePoint );
+
+        if( dist <= mannequin->getRadius() )
+        {
+            probePoint.validity = PointValidity::Valid;
+
+            if( firstValidPointIndex == -1 && mecanicalPoint != mannequin->getEndOfStomach() )
+            {
+                firstValidPointIndex = i;
+                validSegmentEndIndex = i;
+                intervalsEndIndex = i;
+            }
+            else
+                lastValidPointIndex = i;
+
+            validPointsCount++;
+        }
+        else
+        {
+            probePoint.validity = PointValidity::Invalid;
+            invalidPointsCount++;
+        }
+    }
+
+    // the new point can complete an interval after the last valid point even if it is not valid itself
+    updateValidSegment();
+
+    return probeCurve[i].validity;
+}
+
+// Same result as CurveComparer::isCurveValid() on all the points pushed so far
+CurveValidity::Status ValidationSession::currentStatus() const
+{
+    if( mannequin == 0 )
+        return CurveValidity::MannequinUnavailable;
+
+    if( invalidPointsCount > 0 )
+        return CurveValidity::Invalid;
+
+    // same tests as CurveComparer::isThereEnoughData()
+    float probeMedian = -1;
+    if( firstValidPointIndex >= 0 && lastValidPointIndex - firstValidPointIndex + 1 >= 2 )
+        probeMedian = intervals.median();
+
+    if( probeMedian > mannequin->getMaxIntervalMedian() || probeMedian == -1 )
+        return CurveValidity::NotEnoughDataPoints;
+
+    if( fabs( mecanicalLength - validSegmentLength ) > mannequin->getCurveLengthThreshold() * mecanicalLength )
+        return CurveValidity::NotEnoughDataLength;
+
+    return CurveValidity::Valid;
+}
+
+// Find the probePoint equivalent in the mecanical curve (same y, or closest point), like CurveComparer::findEquivalentPoints().
+// Consecutive probe points are close to each other, so the cursor only moves by a few points each time.
+Point ValidationSession::findEquivalentPoint( const Point& probePoint )
+{
+    if( mannequin->getMatching() == Matching::ClosestPoint )
+        return mannequin->findClosestPoint( probePoint );
+
+    int size = mannequin->size();
+
+    // move the cursor to the first mecanical point (starting at 1) with mecanicalPoint.y >= probePoint.y
+    // getMaxYUpTo() never decreases, so it works even if the mecanical curve goes down at some point
+    while( cursor > 1 && mannequin->getMaxYUpTo(cursor-1) >= probePoint.y )
+        --cursor;
+    while( cursor < size && mannequin->getMaxYUpTo(cursor) < probePoint.y )
+        ++cursor;
+
+    // above the last mecanical point, extend the last segment of the curve
+    int pointAfterIndex = ( cursor < size ) ? cursor : size - 1;
+
+    if( mannequin->at(pointAfterIndex).y == probePoint.y )
+        return mannequin->at(pointAfterIndex);
+
+    if( mannequin->isAmbiguousY( probePoint.y ) )
+        ambiguousPointsCount++;
+
+    return CurveComparer::pointAtY( mannequin->at(pointAfterIndex-1), mannequin->at(pointAfterIndex), probePoint.y );
+}
+
+// Add the intervals and segments that became available since the last point
+void ValidationSession::updateValidSegment()
+{
+    if( firstValidPointIndex == -1 )
+        return;
+
+    // findIntervalStatistics() uses the intervals from the first valid point up to the one after the last valid point
+    while( intervalsEndIndex <= lastValidPointIndex && intervalsEndIndex + 1 < probeCurve.size() )
+    {
+        intervals.add( CurveComparer::distanceBetween2Points( probeCurve[intervalsEndIndex], probeCurve[intervalsEndIndex+1] ) );
+        intervalsEndIndex++;
+    }
+
+    // segmentLength( probeCurve, firstValidPointIndex, lastValidPointIndex ) stops one segment before the last valid point
+    while( validSegmentEndIndex < lastValidPointIndex - 1 )
+    {
+        validSegmentLength += CurveComparer::distanceBetween2Points( probeCurve[validSegmentEndIndex], probeCurve[validSegmentEndIndex+1] );
+        validSegmentEndIndex++;
+    }
+}
+
+//  Accessors
+/********************************************************************************/
+
+const Mannequin* ValidationSession::getMannequin() const
+{
+    return mannequin;
+}
+
+const Curve& ValidationSession::getProbeCurve() const
+{
+    return probeCurve;
+}
+
+int ValidationSession::getValidPointsCount() const
+{
+    return validPointsCount;
+}
+
+int ValidationSession::getInvalidPointsCount() const
+{
+    return invalidPointsCount;
+}
+
+int ValidationSession::getIgnoredPointsCount() const
+{
+    return ignoredPointsCount;
+}
+
+int ValidationSession::getAmbiguousPointsCount() const
+{
+    return ambiguousPointsCount;
+}
+
+int ValidationSession::getFirstValidPointIndex() const
+{
+    return firstValidPointIndex;
+}
+
+int ValidationSession::getLastValidPointIndex() const
+{
+    return lastValidPointIndex;
+}
+
+float ValidationSession::getValidSegmentLength() const
+{
+    return validSegmentLength;
+}
+
+IntervalStatistics ValidationSession::getIntervalStatistics() const
+{
+    return intervals.statistics();
+}
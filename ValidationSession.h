@@ -0,0 +1,56 @@
+#ifndef VALIDATIONSESSION_H
+#define VALIDATIONSESSION_H
+
+#include "CurveComparer.h"
+
+// Incremental version of CurveComparer::isCurveValid() for probe points received one by one (ex. from the tracker).
+// Each point is tested once when it is pushed, the counts, the valid segment length and the median of the
+// intervals are kept up to date so currentStatus() doesn't need to go through the whole curve again.
+// currentStatus() returns the same result as isCurveValid() would on all the points pushed so far.
+class ValidationSession
+{
+    private:
+        const Mannequin*        mannequin;
+        Curve                   probeCurve;
+
+        int                     cursor;             // index of the first mecanical point with y >= the last probe point y
+        float                   mecanicalLength;
+        bool                    maxYReached;        // once a point is above maxY, all the following points are ignored
+
+        int     validPointsCount;
+        int     invalidPointsCount;
+        int     ignoredPointsCount;
+        int     ambiguousPointsCount;
+        int     firstValidPointIndex;
+        int     lastValidPointIndex;
+
+        float   validSegmentLength;                 // segmentLength() of the probe curve between the first and last valid points
+        int     validSegmentEndIndex;               // next probe point to add to validSegmentLength
+
+        RunningIntervalStatistics   intervals;      // intervals between the valid points, for the median
+        int                         intervalsEndIndex;  // next interval to add
+
+        Point   findEquivalentPoint( const Point& probePoint );
+        void    updateValidSegment();
+
+    public:
+        ValidationSession( const Mannequin* mannequin );
+
+        PointValidity::Status   pushPoint( const Point& point );
+        CurveValidity::Status   currentStatus() const;
+        void                    reset();
+
+        // accessors
+        const Mannequin* getMannequin() const;
+        const Curve&    getProbeCurve() const;
+        int             getValidPointsCount() const;
+        int             getInvalidPointsCount() const;
+        int             getIgnoredPointsCount() const;
+        int             getAmbiguousPointsCount() const;
+        int             getFirstValidPointIndex() const;
+        int             getLastValidPointIndex() const;
+        float           getValidSegmentLength() const;
+        IntervalStatistics getIntervalStatistics() const;
+};
+
+#endif // VALIDATIONSESSION_H
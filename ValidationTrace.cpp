@@ -0,0 +1,70 @@
+#include "ValidationTrace.h"
+
+#include <cmath>
+#include <QIODevice>
+
+#include "Log.h"
+
+ValidationTrace::ValidationTrace( int capacity )
+{
+    setCapacity( capacity );
+}
+
+// The records kept are lost
+void ValidationTrace::setCapacity( int capacity )
+{
+    records.resize( qMax( capacity, 0 ) );
+    clear();
+}
+
+int ValidationTrace::capacity() const
+{
+    return records.size();
+}
+
+bool ValidationTrace::isEnabled() const
+{
+    return !records.empty();
+}
+
+void ValidationTrace::clear()
+{
+    next = 0;
+    count = 0;
+}
+
+int ValidationTrace::size() const
+{
+    return count;
+}
+
+const TraceRecord& ValidationTrace::at( int i ) const
+{
+    int first = ( count < (int)records.size() ) ? 0 : next;
+    return records[( first + i ) % records.size()];
+}
+
+// Write the records to the log, even when the per point logs are compiled out
+void ValidationTrace::dump() const
+{
+    ESO_LOG_WARNING << "Last" << size() << "points of the validation:";
+
+    for( int i=0; i<size(); ++i )
+    {
+        const TraceRecord& r = at(i);
+        ESO_LOG_WARNING << "probeCurve[" << r.index << "] mecanical point: (" << r.x << ", " << r.y << ", " << r.z << ")"
+                        << "distance:" << sqrt( r.squaredDistance ) << "verdict:" << r.verdict;
+    }
+}
+
+// Write the records as they are in memory, oldest first (see TraceRecord)
+bool ValidationTrace::write( QIODevice* device ) const
+{
+    for( int i=0; i<size(); ++i )
+    {
+        if( device->write( reinterpret_cast<const char*>( &at(i) ), sizeof( TraceRecord ) ) != (qint64)sizeof( TraceRecord ) )
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef VALIDATIONTRACE_H
+#define VALIDATIONTRACE_H
+
+#include <vector>
+#include <QtGlobal>
+
+#include "Point.h"
+
+class QIODevice;
+
+// What was decided for one probe point, 24 bytes, written as is by ValidationTrace::write()
+struct TraceRecord
+{
+    qint32  index;              // index of the probe point
+    float   x, y, z;            // equivalent mecanical point
+    float   squaredDistance;    // between the probe point and its equivalent
+    qint32  verdict;            // PointValidity::Status
+};
+
+// Ring buffer of the decisions of the last validation, kept only for the last capacity points.
+// Recording a point is a copy of 24 bytes, so it can stay enabled and the records are only written
+// (dump() or write()) when the validation fails. Disabled (capacity 0) by default.
+class ValidationTrace
+{
+    private:
+        std::vector<TraceRecord>    records;
+        int                         next;       // where the next record goes
+        int                         count;
+
+    public:
+        ValidationTrace( int capacity = 0 );
+
+        void    setCapacity( int capacity );
+        int     capacity() const;
+        bool    isEnabled() const;
+        void    clear();
+
+        inline void record( int index, const Point& matched, float squaredDistance, PointValidity::Status verdict )
+        {
+            TraceRecord& r = records[next];
+            r.index = index;
+            r.x = matched.x;
+            r.y = matched.y;
+            r.z = matched.z;
+            r.squaredDistance = squaredDistance;
+            r.verdict = verdict;
+
+            if( ++next == (int)records.size() )
+                next = 0;
+            if( count < (int)records.size() )
+                count++;
+        }
+
+        int                 size() const;
+        const TraceRecord&  at( int i ) const;  // 0 is the oldest record kept
+
+        void    dump() const;
+        bool    write( QIODevice* device ) const;
+};
+
+#endif // VALIDATIONTRACE_H
@@ -0,0 +1,231 @@
+#include "ValidationWorker.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+//  ValidationSnapshot
+/********************************************************************************/
+
+ValidationSnapshot::ValidationSnapshot( Job job, const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin ) :
+    job( job ), probeCurve( probeCurve ), mannequin( new Mannequin( mannequin ) )
+{
+    jobId = 0;
+    mannequins = 0;
+    validateNsecs = 0;
+}
+
+// Identification of probeCurve among copies of all the mannequins of the registry
+ValidationSnapshot::ValidationSnapshot( const QSharedPointer<const Curve>& probeCurve, const MannequinRegistry& mannequins ) :
+    job( Identify ), probeCurve( probeCurve )
+{
+    jobId = 0;
+    validateNsecs = 0;
+
+    this->mannequins = new MannequinRegistry();
+    QStringList names = mannequins.names();
+    for( int i=0; i<names.size(); ++i )
+        this->mannequins->addMannequin( new Mannequin( *mannequins.mannequin( names[i] ) ) );
+}
+
+ValidationSnapshot::~ValidationSnapshot()
+{
+    delete mannequins;
+}
+
+// Called once, from the worker thread before the snapshot is given
+void ValidationSnapshot::validate( const QAtomicInt& cancelled )
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    switch( job )
+    {
+        case Validate:
+            CurveComparer::isCurveValid( mannequin.data(), *probeCurve, result, cancelled );
+            break;
+
+        case SweepRadius:
+            sweep.compute( mannequin.data(), *probeCurve );
+            break;
+
+        case Identify:
+            {
+                MannequinIdentifier identifier( mannequins );
+                match = identifier.identify( *probeCurve, QThread::idealThreadCount() );
+            }
+            break;
+    }
+
+    validateNsecs = timer.nsecsElapsed();
+}
+
+int ValidationSnapshot::getJobId() const
+{
+    return jobId;
+}
+
+ValidationSnapshot::Job ValidationSnapshot::getJob() const
+{
+    return job;
+}
+
+const Curve* ValidationSnapshot::getProbeCurve() const
+{
+    return probeCurve.data();
+}
+
+// 0 for an identification
+const Mannequin* ValidationSnapshot::getMannequin() const
+{
+    return mannequin.data();
+}
+
+const ValidationResult& ValidationSnapshot::getResult() const
+{
+    return result;
+}
+
+const RadiusSweep& ValidationSnapshot::getRadiusSweep() const
+{
+    return sweep;
+}
+
+const MannequinMatch& ValidationSnapshot::getMatch() const
+{
+    return match;
+}
+
+qint64 ValidationSnapshot::getValidateNsecs() const
+{
+    return validateNsecs;
+}
+
+//  ValidationWorker
+/********************************************************************************/
+
+ValidationWorker::ValidationWorker( QObject* parent ) : QThread( parent )
+{
+    pendingJob = 0;
+    lastJobId = 0;
+    cancelledJobId = 0;
+    runningCancelled = 0;
+    traceCapacity = 0;
+    stopping = false;
+
+    // for the queued connections of validated()
+    qRegisterMetaType<ValidationSnapshotPtr>( "ValidationSnapshotPtr" );
+}
+
+// The job running is stopped, the one waiting is dropped
+ValidationWorker::~ValidationWorker()
+{
+    {
+        QMutexLocker locker( &mutex );
+        stopping = true;
+        runningCancelled = 1;
+        jobSubmitted.wakeAll();
+    }
+    wait();
+
+    delete pendingJob;
+}
+
+// Validate probeCurve against a copy of mannequin, in place of the jobs not done yet. Return the id of the job.
+// The curve must not be modified anymore, it is shared with the snapshots (and drawn from them).
+int ValidationWorker::submit( const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin )
+{
+    // the copy of the mannequin is made here, in the thread that modifies it
+    return submit( new ValidationSnapshot( ValidationSnapshot::Validate, probeCurve, mannequin ) );
+}
+
+// Same as submit() for the radius sweep of probeCurve with a copy of mannequin
+int ValidationWorker::submitRadiusSweep( const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin )
+{
+    return submit( new ValidationSnapshot( ValidationSnapshot::SweepRadius, probeCurve, mannequin ) );
+}
+
+// Same as submit() for the identification of probeCurve among copies of the mannequins of the registry
+int ValidationWorker::submitIdentification( const QSharedPointer<const Curve>& probeCurve, const MannequinRegistry& mannequins )
+{
+    return submit( new ValidationSnapshot( probeCurve, mannequins ) );
+}
+
+// The job replaces the one waiting (the worker deletes it)
+int ValidationWorker::submit( ValidationSnapshot* job )
+{
+    QMutexLocker locker( &mutex );
+
+    delete pendingJob;
+    pendingJob = job;
+    pendingJob->jobId = ++lastJobId;
+    pendingJob->result.setTraceCapacity( traceCapacity );
+    runningCancelled = 1;
+    jobSubmitted.wakeOne();
+
+    return lastJobId;
+}
+
+// Drop the job waiting and the result of the job running, nothing is given until the next submit()
+void ValidationWorker::cancel()
+{
+    QMutexLocker locker( &mutex );
+
+    delete pendingJob;
+    pendingJob = 0;
+    cancelledJobId = lastJobId;
+    runningCancelled = 1;
+}
+
+// False if another job was submitted since, or if it was cancelled
+bool ValidationWorker::isLastJob( int jobId )
+{
+    QMutexLocker locker( &mutex );
+    return isWanted( jobId );
+}
+
+// With the mutex locked
+bool ValidationWorker::isWanted( int jobId ) const
+{
+    return jobId == lastJobId && jobId > cancelledJobId;
+}
+
+// Keep the decisions of the last capacity points in the results of the next jobs, see ValidationTrace
+void ValidationWorker::setTraceCapacity( int capacity )
+{
+    QMutexLocker locker( &mutex );
+    traceCapacity = capacity;
+}
+
+void ValidationWorker::run()
+{
+    for( ;; )
+    {
+        ValidationSnapshot* job;
+        {
+            QMutexLocker locker( &mutex );
+            while( pendingJob == 0 && !stopping )
+                jobSubmitted.wait( &mutex );
+
+            if( stopping )
+                return;
+
+            job = pendingJob;
+            pendingJob = 0;
+            runningCancelled = 0;
+        }
+
+        job->validate( runningCancelled );
+
+        // a newer job was submitted while this one was validated (it was stopped then), nobody wants it anymore
+        bool wanted;
+        {
+            QMutexLocker locker( &mutex );
+            wanted = isWanted( job->getJobId() );
+        }
+
+        if( wanted )
+            emit validated( ValidationSnapshotPtr( job ) );
+        else
+            delete job;
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef VALIDATIONWORKER_H
+#define VALIDATIONWORKER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <QMetaType>
+
+#include "CurveComparer.h"
+#include "RadiusSweep.h"
+
+// A job done by the ValidationWorker, with everything it was done on: a validation (or the radius sweep or the
+// identification of the probe curve, the tests of the window that are too long for its thread).
+// It has its own copy of the mannequin (its settings as they were when the job was submitted, the curve and the
+// geometry are implicitly shared with the original), so the mannequin of the window can change while it is validated.
+// Once the worker gives it with ValidationWorker::validated(), it is never modified again: it can be drawn
+// and read from any thread for as long as someone keeps a pointer to it.
+class ValidationSnapshot
+{
+    friend class ValidationWorker;
+
+    public:
+        enum Job
+        {
+            Validate = 0,       // CurveComparer::isCurveValid() against the mannequin, see getResult()
+            SweepRadius = 1,    // RadiusSweep::compute() with the mannequin, see getRadiusSweep()
+            Identify = 2        // MannequinIdentifier::identify() with copies of the mannequins of a registry, see getMatch()
+        };
+
+    private:
+        int                         jobId;
+        Job                         job;
+        QSharedPointer<const Curve> probeCurve;
+        QSharedPointer<const Mannequin> mannequin;  // 0 for Identify
+        MannequinRegistry*          mannequins;     // Identify only, 0 otherwise
+        ValidationResult            result;         // its mannequin is the one above
+        RadiusSweep                 sweep;
+        MannequinMatch              match;
+        qint64                      validateNsecs;
+
+        void    validate( const QAtomicInt& cancelled );
+
+        Q_DISABLE_COPY( ValidationSnapshot )
+
+    public:
+        ValidationSnapshot( Job job, const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin );
+        ValidationSnapshot( const QSharedPointer<const Curve>& probeCurve, const MannequinRegistry& mannequins );
+        ~ValidationSnapshot();
+
+        // accessors
+        int                     getJobId() const;
+        Job                     getJob() const;
+        const Curve*            getProbeCurve() const;
+        const Mannequin*        getMannequin() const;
+        const ValidationResult& getResult() const;
+        const RadiusSweep&      getRadiusSweep() const;
+        const MannequinMatch&   getMatch() const;
+        qint64                  getValidateNsecs() const;
+};
+
+typedef QSharedPointer<const ValidationSnapshot> ValidationSnapshotPtr;
+Q_DECLARE_METATYPE( ValidationSnapshotPtr )
+
+// Validate the probe curves on a thread of its own, so the window never waits for a validation.
+//
+// Only the last job submitted matters, whatever its kind: a submit() replaces the job waiting to be started, if any, and
+// the job being validated is cancelled: a validation stops at the end of the block of points it is on (see
+// CurveComparer::FailFastBlockSize), a radius sweep or an identification goes to the end. Its snapshot is dropped instead of given.
+// validated() is emitted from the worker thread, connect it normally and the slot runs in the thread of the receiver.
+// A snapshot can still arrive just after another job was submitted, isLastJob() tells it's out of date.
+class ValidationWorker : public QThread
+{
+    Q_OBJECT
+
+    private:
+        QMutex              mutex;          // for everything below
+        QWaitCondition      jobSubmitted;
+        ValidationSnapshot* pendingJob;     // waiting to be validated, 0 if there is none
+        int                 lastJobId;
+        int                 cancelledJobId; // the jobs up to this one are not given
+        QAtomicInt          runningCancelled; // non zero to stop the job running, read without the mutex by its validation
+        int                 traceCapacity;
+        bool                stopping;
+
+        bool    isWanted( int jobId ) const;
+        int     submit( ValidationSnapshot* job );
+
+    protected:
+        void    run();
+
+    signals:
+        void    validated( ValidationSnapshotPtr snapshot );
+
+    public:
+        ValidationWorker( QObject* parent = 0 );
+        ~ValidationWorker();
+
+        int     submit( const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin );
+        int     submitRadiusSweep( const QSharedPointer<const Curve>& probeCurve, const Mannequin& mannequin );
+        int     submitIdentification( const QSharedPointer<const Curve>& probeCurve, const MannequinRegistry& mannequins );
+        void    cancel();
+        bool    isLastJob( int jobId );
+        void    setTraceCapacity( int capacity );
+};
+
+#endif // VALIDATIONWORKER_H
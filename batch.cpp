@@ -0,0 +1,200 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <cstdio>
+
+#include "Log.h"
+#include "MannequinRegistry.h"
+#include "BatchValidator.h"
+#include "StageMetrics.h"
+
+// Validate recorded probe curves (csv or .probe recordings) against a set of mannequins, on all the cores.
+//
+//  EsoBatch -m bob2.mannequin [-m other.mannequin ...] [-i BOB002 ...] [-e SameHeight|ClosestPoint] [-x] [-j threads] [-f csv|json]
+//           [-o results.csv] [-p metrics.prom [-P seconds]] [-v] [-l level]
+//           files, directories or globs (ex. "recordings/*.csv")
+//
+// Without -i, each file is validated against all the mannequins loaded.
+// -e chooses how the probe points are matched with the mecanical curves (see Matching), SameHeight by default.
+// -x stops each validation at the first invalid point (Evaluation::FailFast), for pass/fail runs: the status is the same,
+// but the counts, median and lengths of the invalid curves are partial or empty.
+// The results go to the output (stdout by default) one line per file and mannequin, the throughput goes to stderr.
+// Only the warnings are logged by default, -v logs the details of each curve and -l trace the details of each point.
+// -p times the stages of the validations and the loaders (see StageMetrics) and writes them to the file ("-" for stdout)
+// at the end, and every -P seconds with it.
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoBatch -m file.mannequin [-m ...] [-i MannequinId ...] [-e SameHeight|ClosestPoint] [-x] [-j threads] [-f csv|json] [-o output] [-p metrics.prom|- [-P seconds]] [-v] [-l trace|debug|info|warning|error|off] files|directories|globs...\n" );
+}
+
+// A directory gives all of its csv and .probe files, a name with * or ? is a glob in its directory
+static QStringList findFiles( const QString& argument )
+{
+    QStringList files;
+    QFileInfo info( argument );
+
+    if( info.isDir() )
+    {
+        QFileInfoList entries = QDir( argument ).entryInfoList( QStringList() << "*.csv" << "*.probe", QDir::Files, QDir::Name );
+        for( int i=0; i<entries.size(); ++i )
+            files.append( entries[i].filePath() );
+    }
+    else if( argument.contains( '*' ) || argument.contains( '?' ) || argument.contains( '[' ) )
+    {
+        QFileInfoList entries = QDir( info.path() ).entryInfoList( QStringList( info.fileName() ), QDir::Files, QDir::Name );
+        for( int i=0; i<entries.size(); ++i )
+            files.append( entries[i].filePath() );
+    }
+    else
+        files.append( argument );
+
+    return files;
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+    Log::setLevel( Log::Warning );
+
+    QStringList arguments = app.arguments();
+    QStringList mannequinFiles;
+    QStringList mannequinIds;
+    QStringList files;
+    QString outputFilename;
+    QString metricsFilename;
+    double metricsInterval = 0.0;
+    int threadsCount = QThread::idealThreadCount();
+    BatchValidator::Format format = BatchValidator::Csv;
+    Matching::Method matching = Matching::SameHeight;
+    bool failFast = false;
+
+    for( int i=1; i<arguments.size(); ++i )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-m" && hasValue )
+            mannequinFiles.append( arguments[++i] );
+        else if( arg == "-i" && hasValue )
+            mannequinIds.append( arguments[++i] );
+        else if( arg == "-e" && hasValue )
+        {
+            if( !Matching::fromName( arguments[++i], matching ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg == "-x" )
+            failFast = true;
+        else if( arg == "-j" && hasValue )
+            threadsCount = arguments[++i].toInt();
+        else if( arg == "-o" && hasValue )
+            outputFilename = arguments[++i];
+        else if( arg == "-p" && hasValue )
+            metricsFilename = arguments[++i];
+        else if( arg == "-P" && hasValue )
+            metricsInterval = arguments[++i].toDouble();
+        else if( arg == "-f" && hasValue )
+        {
+            QString name = arguments[++i];
+            if( name == "csv" )
+                format = BatchValidator::Csv;
+            else if( name == "json" )
+                format = BatchValidator::Json;
+            else
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg == "-v" )
+            Log::setLevel( Log::Debug );
+        else if( arg == "-l" && hasValue )
+        {
+            if( !Log::setLevel( arguments[++i] ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg.startsWith( "-" ) )
+        {
+            usage();
+            return 2;
+        }
+        else
+            files.append( findFiles( arg ) );
+    }
+
+    if( mannequinFiles.isEmpty() || files.isEmpty() )
+    {
+        usage();
+        return 2;
+    }
+
+    // the stages are timed from the loading of the mannequins
+    StageMetrics::setEnabled( !metricsFilename.isEmpty() );
+
+    MannequinRegistry mannequins;
+    for( int i=0; i<mannequinFiles.size(); ++i )
+    {
+        Mannequin* mannequin = new Mannequin( mannequinFiles[i] );
+        mannequin->setMatching( matching );
+        mannequins.addMannequin( mannequin );
+    }
+
+    if( mannequinIds.isEmpty() )
+        mannequinIds = mannequins.names();
+
+    for( int i=0; i<mannequinIds.size(); ++i )
+    {
+        if( !mannequins.contains( mannequinIds[i] ) )
+        {
+            fprintf( stderr, "Mannequin %s not found.\n", qPrintable( mannequinIds[i] ) );
+            return 1;
+        }
+    }
+
+    QFile outputFile;
+    QTextStream output( stdout );
+    if( !outputFilename.isEmpty() )
+    {
+        outputFile.setFileName( outputFilename );
+        if( !outputFile.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        {
+            fprintf( stderr, "Can't write to %s.\n", qPrintable( outputFilename ) );
+            return 1;
+        }
+        output.setDevice( &outputFile );
+    }
+
+    StageMetricsDumper* metricsDumper = 0;
+    if( !metricsFilename.isEmpty() && metricsInterval > 0.0 )
+    {
+        metricsDumper = new StageMetricsDumper( metricsFilename, int( metricsInterval * 1000 ) );
+        metricsDumper->start();
+    }
+
+    BatchValidator validator( &mannequins, mannequinIds );
+    validator.setFailFast( failFast );
+    validator.run( files, threadsCount, &output, format );
+
+    // the dumper writes the last metrics when it stops
+    if( metricsDumper )
+        delete metricsDumper;
+    else if( !metricsFilename.isEmpty() && !StageMetrics::dump( metricsFilename ) )
+        fprintf( stderr, "Can't write the stage metrics to %s.\n", qPrintable( metricsFilename ) );
+
+    fprintf( stderr, "%d files (%d unreadable), %lld points, %d mannequins, %d threads in %.3f s: %.1f files/s, %.0f points/s\n",
+             validator.getFilesCount(), validator.getFailedFilesCount(), validator.getPointsCount(),
+             mannequinIds.size(), threadsCount < 1 ? 1 : threadsCount, validator.getElapsedNsecs() / 1e9,
+             validator.getFilesPerSecond(), validator.getPointsPerSecond() );
+
+    return validator.getFailedFilesCount() > 0 ? 1 : 0;
+}
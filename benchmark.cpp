@@ -0,0 +1,458 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+
+#include "CurveComparer.h"
+#include "DistanceKernels.h"
+#include "Json.h"
+#include "Log.h"
+#include "ProbeCurveLoader.h"
+#include "ProbeRecording.h"
+
+// Time each stage of the validation on the shipped fixtures and on synthetic curves of 10^2 to 10^7 points.
+// The matching with the mecanical curve is timed with both methods (see Matching).
+//
+//  EsoBenchmark [-d fixturesDirectory] [-n maxPoints] [-t secondsPerMeasure] [-o results.json]
+//
+// The results go to the output (stdout by default) as one json document, to compare the builds with each other,
+// and a summary goes to stderr. Each measure is the median of runs of at least MinSampleNsecs, repeated during
+// secondsPerMeasure (0.2 by default) and at least MinSamples times.
+
+static const qint64 MinSampleNsecs = 20000;
+static const int    MinSamples = 5;
+
+static const char* Fixtures[] = { "probe1.csv", "probe2.csv", "probe3.csv", "zigzag_fast.csv", "zigzag_slow.csv", "wait.csv", "too_fast.csv" };
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoBenchmark [-d fixturesDirectory] [-n maxPoints] [-t secondsPerMeasure] [-o results.json]\n" );
+}
+
+// Friend of CurveComparer, to time its stages one by one
+class Benchmark
+{
+    public:
+        enum Stage
+        {
+            SegmentLength,
+            FindIntervalStatistics,
+            FindEquivalentPoints,
+            IsCurveValid,
+            IsCurveValidFailFast,
+            LoadCsv,
+            LoadRecording,
+            LoadMannequinXml,
+            LoadMannequinCache
+        };
+
+    private:
+        struct Measure
+        {
+            QString name;
+            QString input;
+            QString matching;       // for the stages of CurveComparer
+            int     points;
+            int     samples;
+            qint64  runs;
+            double  minNsecs;       // per run
+            double  medianNsecs;
+            double  meanNsecs;
+        };
+
+        double          minNsecs;
+        QList<Measure>  measures;
+
+        // what the stages work on
+        Mannequin*          mannequin;
+        QString             filename;
+        Curve               curve;
+        ValidationResult    result;
+        Curve               loaded;
+        volatile float      sink;       // so the results are not optimized away
+
+        void    runOnce( Stage stage );
+        void    measure( Stage stage, const QString& input, int points );
+
+    public:
+        Benchmark( Mannequin* mannequin, double minSeconds );
+
+        void    benchmarkCurve( const QString& input, const Curve& curve );
+        void    benchmarkFile( const QString& input, const QString& filename, Stage stage, int points );
+        void    benchmarkMannequin( const QString& filename );
+
+        void    writeJson( QTextStream& output, const QString& fixturesDirectory ) const;
+
+        static const char*  stageName( Stage stage );
+        static Curve        syntheticCurve( const Mannequin& mannequin, int count );
+        static bool         writeCsv( const QString& filename, const Curve& curve );
+};
+
+Benchmark::Benchmark( Mannequin* mannequin, double minSeconds )
+{
+    this->mannequin = mannequin;
+    minNsecs = minSeconds * 1e9;
+    sink = 0.0f;
+}
+
+const char* Benchmark::stageName( Stage stage )
+{
+    switch( stage )
+    {
+        case SegmentLength:             return "CurveComparer::segmentLength";
+        case FindIntervalStatistics:    return "CurveComparer::findIntervalStatistics";
+        case FindEquivalentPoints:      return "CurveComparer::findEquivalentPoints";
+        case IsCurveValid:              return "CurveComparer::isCurveValid";
+        case IsCurveValidFailFast:      return "CurveComparer::isCurveValid<FailFast>";
+        case LoadCsv:                   return "ProbeCurveLoader::load";
+        case LoadRecording:             return "ProbeRecordingReader::load";
+        case LoadMannequinXml:          return "Mannequin::loadMannequin (xml)";
+        case LoadMannequinCache:        return "Mannequin::loadMannequin (cache)";
+    }
+    return "";
+}
+
+// The stages of CurveComparer use the result of a whole validation of curve, like they do in isCurveValid()
+void Benchmark::runOnce( Stage stage )
+{
+    switch( stage )
+    {
+        case SegmentLength:
+            sink = CurveComparer::segmentLength( curve, 0, curve.size() - 1, result );
+            break;
+
+        case FindIntervalStatistics:
+            sink = CurveComparer::findIntervalStatistics( *mannequin, curve, 0, curve.size() - 1, result ).median;
+            break;
+
+        case FindEquivalentPoints:
+            CurveComparer::findEquivalentPoints( *mannequin, curve, result );
+            break;
+
+        case IsCurveValid:
+            sink = CurveComparer::isCurveValid( mannequin, curve, result );
+            break;
+
+        case IsCurveValidFailFast:
+            sink = CurveComparer::isCurveValid<Evaluation::FailFast>( mannequin, curve, result );
+            break;
+
+        case LoadCsv:
+            ProbeCurveLoader::load( filename, loaded );
+            sink = loaded.size();
+            break;
+
+        case LoadRecording:
+            ProbeRecordingReader::load( filename, loaded );
+            sink = loaded.size();
+            break;
+
+        // the cache is removed to read the xml, it is written again like the first time a mannequin is loaded
+        case LoadMannequinXml:
+            QFile::remove( Mannequin::cacheFilename( filename ) );
+            mannequin->loadMannequin( filename );
+            sink = mannequin->size();
+            break;
+
+        case LoadMannequinCache:
+            mannequin->loadMannequin( filename );
+            sink = mannequin->size();
+            break;
+    }
+}
+
+void Benchmark::measure( Stage stage, const QString& input, int points )
+{
+    // enough runs in a sample for the timer to be precise
+    qint64 runs = 1;
+    for( ;; )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<runs; ++i )
+            runOnce( stage );
+        if( timer.nsecsElapsed() >= MinSampleNsecs )
+            break;
+        runs *= 2;
+    }
+
+    QVector<double> samples;
+    QElapsedTimer total;
+    total.start();
+
+    while( samples.size() < MinSamples || total.nsecsElapsed() < minNsecs )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<runs; ++i )
+            runOnce( stage );
+        samples.append( double( timer.nsecsElapsed() ) / runs );
+    }
+
+    std::sort( samples.begin(), samples.end() );
+
+    Measure m;
+    m.name = stageName( stage );
+    m.input = input;
+    if( stage <= IsCurveValidFailFast )
+        m.matching = Matching::name( mannequin->getMatching() );
+    m.points = points;
+    m.samples = samples.size();
+    m.runs = runs * samples.size();
+    m.minNsecs = samples.first();
+    m.medianNsecs = samples[samples.size() / 2];
+    m.meanNsecs = 0.0;
+    for( int i=0; i<samples.size(); ++i )
+        m.meanNsecs += samples[i];
+    m.meanNsecs /= samples.size();
+    measures.append( m );
+
+    fprintf( stderr, "%-40s %-12s %-24s %9d points %14.0f ns %10.2f ns/point\n", qPrintable( m.name ), qPrintable( m.matching ),
+             qPrintable( input ), points, m.medianNsecs, points > 0 ? m.medianNsecs / points : 0.0 );
+}
+
+void Benchmark::benchmarkCurve( const QString& input, const Curve& curve )
+{
+    this->curve = curve;
+    if( curve.size() < 2 )
+        return;
+
+    // sizes the buffers of the result and sets the ignored points for the stages
+    CurveComparer::isCurveValid( mannequin, this->curve, result );
+
+    measure( SegmentLength, input, curve.size() );
+    measure( FindIntervalStatistics, input, curve.size() );
+    measure( FindEquivalentPoints, input, curve.size() );
+    measure( IsCurveValid, input, curve.size() );
+    measure( IsCurveValidFailFast, input, curve.size() );
+
+    // the matching stages again with the other method
+    mannequin->setMatching( Matching::ClosestPoint );
+    CurveComparer::isCurveValid( mannequin, this->curve, result );
+    measure( FindEquivalentPoints, input, curve.size() );
+    measure( IsCurveValid, input, curve.size() );
+    measure( IsCurveValidFailFast, input, curve.size() );
+    mannequin->setMatching( Matching::SameHeight );
+
+    this->curve.clear();
+}
+
+void Benchmark::benchmarkFile( const QString& input, const QString& filename, Stage stage, int points )
+{
+    this->filename = filename;
+    measure( stage, input, points );
+    loaded.clear();
+}
+
+// Loaded in another mannequin, the one validating the curves is not modified
+void Benchmark::benchmarkMannequin( const QString& filename )
+{
+    Mannequin* validated = mannequin;
+    mannequin = new Mannequin( filename );
+    this->filename = filename;
+
+    measure( LoadMannequinXml, QFileInfo( filename ).fileName(), mannequin->size() );
+    measure( LoadMannequinCache, QFileInfo( filename ).fileName(), mannequin->size() );
+
+    delete mannequin;
+    mannequin = validated;
+}
+
+void Benchmark::writeJson( QTextStream& output, const QString& fixturesDirectory ) const
+{
+    output << "{\n";
+    output << "  \"date\": " << Json::quote( QDateTime::currentDateTime().toString( Qt::ISODate ) ) << ",\n";
+    output << "  \"qt\": " << Json::quote( qVersion() ) << ",\n";
+#ifdef __VERSION__
+    output << "  \"compiler\": " << Json::quote( __VERSION__ ) << ",\n";
+#endif
+    output << "  \"instructionSet\": " << Json::quote( DistanceKernels::instructionSetName( DistanceKernels::instructionSet() ) ) << ",\n";
+    output << "  \"logCompiledLevel\": " << ESO_LOG_COMPILED_LEVEL << ",\n";
+    output << "  \"fixtures\": " << Json::quote( fixturesDirectory ) << ",\n";
+    output << "  \"results\": [\n";
+
+    for( int i=0; i<measures.size(); ++i )
+    {
+        const Measure& m = measures[i];
+        output << "    {\"name\": " << Json::quote( m.name )
+               << ", \"input\": " << Json::quote( m.input )
+               << ", \"matching\": " << Json::quote( m.matching )
+               << ", \"points\": " << m.points
+               << ", \"samples\": " << m.samples
+               << ", \"runs\": " << m.runs
+               << ", \"minNs\": " << QString::number( m.minNsecs, 'f', 1 )
+               << ", \"medianNs\": " << QString::number( m.medianNsecs, 'f', 1 )
+               << ", \"meanNs\": " << QString::number( m.meanNsecs, 'f', 1 )
+               << ", \"nsPerPoint\": " << QString::number( m.points > 0 ? m.medianNsecs / m.points : 0.0, 'f', 3 )
+               << "}" << ( i + 1 < measures.size() ? ",\n" : "\n" );
+    }
+
+    output << "  ]\n";
+    output << "}\n";
+    output.flush();
+}
+
+// count points going up the mecanical curve from its first point to maxY, at most 0.5 from it in x and z
+// (always the same ones, the noise is a fixed pseudo random sequence)
+Curve Benchmark::syntheticCurve( const Mannequin& mannequin, int count )
+{
+    Curve curve( count );
+    quint32 random = 12345;
+
+    int last = mannequin.findPointAfter( mannequin.getMaxY() );
+    if( last >= mannequin.size() )
+        last = mannequin.size() - 1;
+    float length = mannequin.getArcLength( last );
+
+    int segment = 0;
+    for( int i=0; i<count; ++i )
+    {
+        float distance = length * i / qMax( count - 1, 1 );
+        while( segment < last - 1 && mannequin.getArcLength( segment + 1 ) < distance )
+            segment++;
+
+        float segmentLength = mannequin.getSegmentLength( segment );
+        float t = ( segmentLength > 0.0f ) ? ( distance - mannequin.getArcLength( segment ) ) / segmentLength : 0.0f;
+        const Point& a = mannequin[segment];
+        const Point& b = mannequin[segment + 1];
+
+        random = random * 1664525u + 1013904223u;
+        float dx = ( ( random >> 8 ) / 16777216.0f - 0.5f );
+        random = random * 1664525u + 1013904223u;
+        float dz = ( ( random >> 8 ) / 16777216.0f - 0.5f );
+
+        curve.append( Point( a.x + ( b.x - a.x ) * t + dx, a.y + ( b.y - a.y ) * t, a.z + ( b.z - a.z ) * t + dz ) );
+    }
+
+    return curve;
+}
+
+bool Benchmark::writeCsv( const QString& filename, const Curve& curve )
+{
+    QFile file( filename );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return false;
+
+    QByteArray lines;
+    char line[64];
+    for( int i=0; i<curve.size(); ++i )
+    {
+        int size = qsnprintf( line, sizeof( line ), "%.4f;%.4f;%.4f\n", curve[i].x, curve[i].y, curve[i].z );
+        lines.append( line, size );
+
+        if( lines.size() > ( 1 << 20 ) || i == curve.size() - 1 )
+        {
+            if( file.write( lines ) != lines.size() )
+                return false;
+            lines.clear();
+        }
+    }
+    return true;
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+
+    // the warnings of the validations (ex. ambiguous points) would be repeated at each run
+    Log::setLevel( Log::Error );
+
+    QStringList arguments = app.arguments();
+    QString fixturesDirectory = ".";
+    QString outputFilename;
+    int maxPoints = 10000000;
+    double minSeconds = 0.2;
+
+    for( int i = 1; i < arguments.size(); i++ )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-d" && hasValue )
+            fixturesDirectory = arguments[++i];
+        else if( arg == "-n" && hasValue )
+            maxPoints = arguments[++i].toInt();
+        else if( arg == "-t" && hasValue )
+            minSeconds = arguments[++i].toDouble();
+        else if( arg == "-o" && hasValue )
+            outputFilename = arguments[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    QDir fixtures( fixturesDirectory );
+    QString mannequinFilename = fixtures.filePath( "bob2.mannequin" );
+    Mannequin* mannequin = new Mannequin( mannequinFilename );
+    if( mannequin->size() < 2 )
+    {
+        fprintf( stderr, "Can't load %s.\n", qPrintable( mannequinFilename ) );
+        delete mannequin;
+        return 1;
+    }
+
+    QFile outputFile;
+    QTextStream output( stdout );
+    if( !outputFilename.isEmpty() )
+    {
+        outputFile.setFileName( outputFilename );
+        if( !outputFile.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        {
+            fprintf( stderr, "Can't write to %s.\n", qPrintable( outputFilename ) );
+            delete mannequin;
+            return 1;
+        }
+        output.setDevice( &outputFile );
+    }
+
+    Benchmark benchmark( mannequin, minSeconds );
+
+    benchmark.benchmarkMannequin( mannequinFilename );
+
+    for( unsigned int i = 0; i < sizeof( Fixtures ) / sizeof( Fixtures[0] ); i++ )
+    {
+        QString filename = fixtures.filePath( Fixtures[i] );
+        Curve curve;
+        if( !ProbeCurveLoader::load( filename, curve ) )
+        {
+            fprintf( stderr, "Can't load %s.\n", qPrintable( filename ) );
+            continue;
+        }
+
+        benchmark.benchmarkFile( Fixtures[i], filename, Benchmark::LoadCsv, curve.size() );
+        benchmark.benchmarkCurve( Fixtures[i], curve );
+    }
+
+    // the synthetic curves are written in the temporary directory to time the loaders
+    QString csvFilename = QDir::temp().filePath( "EsoBenchmark.csv" );
+    QString recordingFilename = QDir::temp().filePath( "EsoBenchmark.probe" );
+
+    for( qint64 count = 100; count <= maxPoints; count *= 10 )
+    {
+        QString input = QString( "synthetic %1" ).arg( count );
+        Curve curve = Benchmark::syntheticCurve( *mannequin, count );
+
+        if( Benchmark::writeCsv( csvFilename, curve ) )
+            benchmark.benchmarkFile( input, csvFilename, Benchmark::LoadCsv, count );
+        if( ProbeRecordingWriter::save( recordingFilename, curve, RecordingInfo() ) )
+            benchmark.benchmarkFile( input, recordingFilename, Benchmark::LoadRecording, count );
+        QFile::remove( csvFilename );
+        QFile::remove( recordingFilename );
+
+        benchmark.benchmarkCurve( input, curve );
+    }
+
+    benchmark.writeJson( output, fixtures.absolutePath() );
+
+    delete mannequin;
+    return 0;
+}
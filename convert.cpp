@@ -0,0 +1,128 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFileInfo>
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+
+#include "Log.h"
+#include "ProbeCurveLoader.h"
+#include "ProbeRecording.h"
+
+// Convert the csv probe curves to .probe recordings, and the recordings back to csv.
+//
+//  EsoConvert [-i MannequinId] [-r sampleRate] [-t mannequin|tracker] [-e delta|raw] [-z] [-c chunkPoints] files...
+//
+// Each file is written next to it: probe1.csv gives probe1.probe and probe1.probe gives probe1.csv.
+// The csv files don't say anything about the recording, -i, -r and -t give the mannequin, the points per second
+// and the coordinate frame written in the header. -z compresses the chunks.
+// -e delta (the default) writes the smallest files, their points are decoded when they are read. -e raw without -z
+// writes the points as floats that ProbeRecordingReader::chunkView() reads in place, without decoding them.
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoConvert [-i MannequinId] [-r sampleRate] [-t mannequin|tracker] [-e delta|raw] [-z] [-c chunkPoints] files...\n" );
+}
+
+// x;y;z with enough digits to read back the same floats
+static bool writeCsv( const QString& filename, const Curve& curve )
+{
+    QFile file( filename );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        return false;
+
+    QTextStream output( &file );
+    for( int i=0; i<curve.size(); ++i )
+    {
+        output << QString::number( curve[i].x, 'g', 9 ) << ';'
+               << QString::number( curve[i].y, 'g', 9 ) << ';'
+               << QString::number( curve[i].z, 'g', 9 ) << '\n';
+    }
+    output.flush();
+
+    return file.error() == QFile::NoError;
+}
+
+static bool convert( const QString& filename, const RecordingInfo& info, RecordingEncoding::Encoding encoding, bool compressed, int chunkSize )
+{
+    QFileInfo fileInfo( filename );
+    QString base = fileInfo.path() + "/" + fileInfo.completeBaseName();
+    Curve curve;
+
+    if( ProbeRecordingReader::isRecording( filename ) )
+    {
+        if( !ProbeRecordingReader::load( filename, curve ) || !writeCsv( base + ".csv", curve ) )
+            return false;
+
+        fprintf( stderr, "%s: %d points -> %s.csv\n", qPrintable( filename ), curve.size(), qPrintable( base ) );
+        return true;
+    }
+
+    if( !ProbeCurveLoader::load( filename, curve ) )
+        return false;
+
+    ProbeRecordingWriter writer;
+    if( !writer.open( base + ".probe", info, encoding, compressed, chunkSize ) || !writer.append( curve ) || !writer.close() )
+        return false;
+
+    fprintf( stderr, "%s: %d points, %lld bytes -> %s.probe, %lld bytes\n", qPrintable( filename ), curve.size(), fileInfo.size(),
+             qPrintable( base ), QFileInfo( base + ".probe" ).size() );
+    return true;
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+    Log::setLevel( Log::Warning );
+
+    QStringList arguments = app.arguments();
+    QStringList files;
+    RecordingInfo info;
+    RecordingEncoding::Encoding encoding = RecordingEncoding::Delta;
+    bool compressed = false;
+    int chunkSize = 4096;
+
+    for( int i=1; i<arguments.size(); ++i )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-i" && hasValue )
+            info.mannequinId = arguments[++i];
+        else if( arg == "-r" && hasValue )
+            info.sampleRate = arguments[++i].toFloat();
+        else if( arg == "-c" && hasValue )
+            chunkSize = arguments[++i].toInt();
+        else if( arg == "-z" )
+            compressed = true;
+        else if( arg == "-t" && hasValue && ( arguments[i+1] == "mannequin" || arguments[i+1] == "tracker" ) )
+            info.frame = ( arguments[++i] == "tracker" ) ? CoordinateFrame::Tracker : CoordinateFrame::Mannequin;
+        else if( arg == "-e" && hasValue && ( arguments[i+1] == "delta" || arguments[i+1] == "raw" ) )
+            encoding = ( arguments[++i] == "raw" ) ? RecordingEncoding::Raw : RecordingEncoding::Delta;
+        else if( arg.startsWith( "-" ) )
+        {
+            usage();
+            return 2;
+        }
+        else
+            files.append( arg );
+    }
+
+    if( files.isEmpty() || chunkSize < 1 )
+    {
+        usage();
+        return 2;
+    }
+
+    int failed = 0;
+    for( int i=0; i<files.size(); ++i )
+    {
+        if( !convert( files[i], info, encoding, compressed, chunkSize ) )
+        {
+            fprintf( stderr, "Can't convert %s.\n", qPrintable( files[i] ) );
+            failed++;
+        }
+    }
+
+    return failed > 0 ? 1 : 0;
+}
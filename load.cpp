@@ -0,0 +1,158 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <cstdio>
+
+#include "Log.h"
+#include "Mannequin.h"
+#include "LoadSimulator.h"
+
+// Load test of the live validation: how many trainee stations can one host serve.
+//
+//  EsoLoad -m bob2.mannequin [-n 1,2,4,8,...] [-d seconds] [-z rate] [-s speed] [-j jitterMsecs] [-g noiseMm]
+//          [-c ringCapacity] [-S seed] [-e SameHeight|ClosestPoint] [-v] [-l level]
+//          zigzag_slow.csv wait.csv too_fast.csv ...
+//
+// For each number of sessions of -n (1 to 64 by default), the sessions replay the csv files in a loop for -d seconds
+// (5 by default) through the same pipeline as EsoTracker, at rate points per second (240 by default) speed times
+// faster than real time (1 by default). -j delays each point by up to jitterMsecs, -g moves it by a gaussian noise.
+// One line per number of sessions goes to stdout: the throughput, the drops, the verdicts of the attempts,
+// the percentiles of the latency from the arrival of a point to its verdict, and the cpu used by each session.
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoLoad -m file.mannequin [-n 1,2,4,...] [-d seconds] [-z rate] [-s speed] [-j jitterMsecs] [-g noiseMm] [-c ringCapacity] [-S seed] [-e SameHeight|ClosestPoint] [-v] [-l trace|debug|info|warning|error|off] files.csv...\n" );
+}
+
+static bool parseCounts( const QString& text, QList<int>& counts )
+{
+    QStringList items = text.split( ',', QString::SkipEmptyParts );
+    counts.clear();
+    for( int i=0; i<items.size(); ++i )
+    {
+        bool ok;
+        int count = items[i].toInt( &ok );
+        if( !ok || count <= 0 )
+            return false;
+        counts.append( count );
+    }
+    return !counts.isEmpty();
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+    Log::setLevel( Log::Warning );
+
+    QStringList arguments = app.arguments();
+    QString mannequinFile;
+    QStringList files;
+    QList<int> sessionsCounts;
+    sessionsCounts << 1 << 2 << 4 << 8 << 16 << 32 << 64;
+    double seconds = 5.0;
+    double rate = 240.0;
+    double speed = 1.0;
+    double jitter = 0.0;
+    double noise = 0.0;
+    int ringCapacity = 4096;
+    quint32 seed = 12345;
+    Matching::Method matching = Matching::SameHeight;
+
+    for( int i=1; i<arguments.size(); ++i )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-m" && hasValue )
+            mannequinFile = arguments[++i];
+        else if( arg == "-n" && hasValue )
+        {
+            if( !parseCounts( arguments[++i], sessionsCounts ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg == "-d" && hasValue )
+            seconds = arguments[++i].toDouble();
+        else if( arg == "-z" && hasValue )
+            rate = arguments[++i].toDouble();
+        else if( arg == "-s" && hasValue )
+            speed = arguments[++i].toDouble();
+        else if( arg == "-j" && hasValue )
+            jitter = arguments[++i].toDouble();
+        else if( arg == "-g" && hasValue )
+            noise = arguments[++i].toDouble();
+        else if( arg == "-c" && hasValue )
+            ringCapacity = arguments[++i].toInt();
+        else if( arg == "-S" && hasValue )
+            seed = arguments[++i].toUInt();
+        else if( arg == "-e" && hasValue )
+        {
+            if( !Matching::fromName( arguments[++i], matching ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg == "-v" )
+            Log::setLevel( Log::Debug );
+        else if( arg == "-l" && hasValue )
+        {
+            if( !Log::setLevel( arguments[++i] ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg.startsWith( "-" ) )
+        {
+            usage();
+            return 2;
+        }
+        else
+            files.append( arg );
+    }
+
+    if( mannequinFile.isEmpty() || files.isEmpty() || seconds <= 0.0 || rate <= 0.0 )
+    {
+        usage();
+        return 2;
+    }
+
+    Mannequin mannequin( mannequinFile );
+    mannequin.setMatching( matching );
+
+    LoadSimulator simulator( &mannequin, files );
+    simulator.setRate( rate );
+    simulator.setSpeed( speed );
+    simulator.setJitter( jitter );
+    simulator.setNoise( float( noise ) );
+    simulator.setRingCapacity( ringCapacity );
+    simulator.setSeed( seed );
+
+    fprintf( stderr, "%d files at %g points/s x%g, jitter %g ms, noise %g mm, %g s per step\n",
+             files.size(), rate, speed, jitter, noise, seconds );
+
+    printf( "sessions   points/s    dropped  attempts   valid invalid   p50 ms   p90 ms   p99 ms p99.9 ms   max ms  cpu/session  cpu ns/point\n" );
+    fflush( stdout );
+
+    bool dropped = false;
+    for( int i=0; i<sessionsCounts.size(); ++i )
+    {
+        LoadStep step = simulator.run( sessionsCounts[i], seconds );
+        const LatencyHistogram& latency = step.latency;
+
+        printf( "%8d %10.0f %10lld %9lld %7lld %7lld %8.3f %8.3f %8.3f %8.3f %8.3f %11.2f%% %13.0f\n",
+                step.sessionsCount, step.pointsPerSecond(), step.droppedCount,
+                step.attemptsCount, step.validAttemptsCount, step.invalidAttemptsCount,
+                latency.percentile( 0.5 ) / 1e6, latency.percentile( 0.9 ) / 1e6, latency.percentile( 0.99 ) / 1e6,
+                latency.percentile( 0.999 ) / 1e6, latency.getMax() / 1e6,
+                step.cpuPerSession() * 100.0, step.cpuNsecsPerPoint() );
+        fflush( stdout );
+
+        dropped = dropped || step.droppedCount > 0;
+    }
+
+    // some samples were lost: the host couldn't keep up with all the sessions
+    return dropped ? 1 : 0;
+}
@@ -0,0 +1,426 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+
+#include "CurveComparer.h"
+#include "Log.h"
+#include "ProbeCurveLoader.h"
+#include "ValidationSession.h"
+
+// Regression test of the validation: each fixture is validated against bob2.mannequin and its status and the verdict
+// of each point must be the ones of its golden file (probe1.csv -> probe1.golden). The 95th percentile of the
+// validation time must also stay within the budget of the golden file.
+//
+//  EsoRegression [-d fixturesDirectory] [-m file.mannequin] [-r runs] [-s budgetScale] [-u]
+//
+// -s multiplies the budgets (ex. -s 10 for a debug build), -u writes the golden files again from the current results
+// (keeping their budgets): only after checking that the new verdicts are the right ones.
+// The mannequin is first loaded from a copy of its xml without a cache, then again from the cache written by that load:
+// both must give the same mecanical curve and the same derived data (lengths, bounds, index, segment tree), and each
+// fixture is validated against both loads with the same golden file. -u writes the verdicts of the xml load, so the
+// golden files never depend on a cache left next to the mannequin.
+// Each fixture is also pushed point by point in a ValidationSession (the live validation of the tracker): its verdicts,
+// counts and currentStatus() at the end must be the ones of the validation of the whole curve.
+// Returns 0 when every fixture passes, 1 otherwise.
+
+static const char* Fixtures[] = { "probe1.csv", "probe2.csv", "probe3.csv", "zigzag_fast.csv", "zigzag_slow.csv", "wait.csv", "too_fast.csv" };
+
+static const double DefaultBudgetUsecs = 1000.0;
+static const int    MaxDifferencesShown = 10;
+
+struct Golden
+{
+    CurveValidity::Status           status;
+    double                          budgetUsecs;
+    QVector<PointValidity::Status>  verdicts;
+};
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoRegression [-d fixturesDirectory] [-m file.mannequin] [-r runs] [-s budgetScale] [-u]\n" );
+}
+
+static QString goldenFilename( const QString& fixture )
+{
+    QFileInfo info( fixture );
+    return info.path() + "/" + info.completeBaseName() + ".golden";
+}
+
+static bool curveStatus( const QString& name, CurveValidity::Status& status )
+{
+    for( int s=CurveValidity::NotTested; s<=CurveValidity::MannequinUnavailable; ++s )
+    {
+        if( name == CurveValidity::name( CurveValidity::Status( s ) ) )
+        {
+            status = CurveValidity::Status( s );
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool pointStatus( const QString& name, PointValidity::Status& status )
+{
+    for( int s=PointValidity::NotTested; s<=PointValidity::Ignored; ++s )
+    {
+        if( name == PointValidity::name( PointValidity::Status( s ) ) )
+        {
+            status = PointValidity::Status( s );
+            return true;
+        }
+    }
+    return false;
+}
+
+// "key;value" lines then "index;verdict" for each point, the lines starting with # are comments
+static bool readGolden( const QString& filename, Golden& golden )
+{
+    QFile file( filename );
+    if( !file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+        return false;
+
+    golden.status = CurveValidity::NotTested;
+    golden.budgetUsecs = DefaultBudgetUsecs;
+    golden.verdicts.clear();
+
+    QTextStream input( &file );
+    bool hasStatus = false;
+    int pointsCount = -1;
+
+    while( !input.atEnd() )
+    {
+        QString line = input.readLine().trimmed();
+        if( line.isEmpty() || line.startsWith( "#" ) )
+            continue;
+
+        QStringList fields = line.split( ";" );
+        if( fields.size() != 2 )
+            return false;
+
+        bool ok = true;
+        if( fields[0] == "status" )
+            ok = hasStatus = curveStatus( fields[1], golden.status );
+        else if( fields[0] == "budgetUs" )
+            golden.budgetUsecs = fields[1].toDouble( &ok );
+        else if( fields[0] == "points" )
+            pointsCount = fields[1].toInt( &ok );
+        else
+        {
+            PointValidity::Status verdict;
+            int index = fields[0].toInt( &ok );
+            ok = ok && index == golden.verdicts.size() && pointStatus( fields[1], verdict );
+            if( ok )
+                golden.verdicts.append( verdict );
+        }
+
+        if( !ok )
+            return false;
+    }
+
+    return hasStatus && pointsCount == golden.verdicts.size();
+}
+
+static bool writeGolden( const QString& filename, const QString& fixture, const QString& mannequin, const ValidationResult& result, double budgetUsecs )
+{
+    QFile file( filename );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) )
+        return false;
+
+    QTextStream output( &file );
+    output << "# verdicts of " << fixture << " validated against " << mannequin << " loaded from its xml, written by EsoRegression -u\n";
+    output << "status;" << CurveValidity::name( result.getStatus() ) << "\n";
+    output << "budgetUs;" << budgetUsecs << "\n";
+    output << "points;" << result.size() << "\n";
+    for( int i=0; i<result.size(); ++i )
+        output << i << ";" << PointValidity::name( result.getVerdict( i ) ) << "\n";
+    output.flush();
+
+    return file.error() == QFile::NoError;
+}
+
+// Differences between the same mannequin loaded from its xml and from its cache, empty if there is none
+static QStringList compare( const Mannequin& xml, const Mannequin& cached )
+{
+    QStringList differences;
+
+    if( xml.getName() != cached.getName() )
+        differences.append( QString( "name %1 from the xml, %2 from the cache" ).arg( xml.getName() ).arg( cached.getName() ) );
+
+    if( xml.size() != cached.size() )
+    {
+        differences.append( QString( "%1 points from the xml, %2 from the cache" ).arg( xml.size() ).arg( cached.size() ) );
+        return differences;
+    }
+
+    if( xml.getLength() != cached.getLength() || xml.getLength() <= 0.0f )
+        differences.append( QString( "length %1 from the xml, %2 from the cache" ).arg( xml.getLength() ).arg( cached.getLength() ) );
+
+    if( xml.getLowestY() != cached.getLowestY() || xml.getHighestY() != cached.getHighestY()
+        || xml.getBoundsMin() != cached.getBoundsMin() || xml.getBoundsMax() != cached.getBoundsMax() )
+        differences.append( "bounds different" );
+
+    // the per point data is not there either
+    if( !differences.isEmpty() )
+        return differences;
+
+    for( int i=0; i<xml.size() && differences.size() < MaxDifferencesShown; ++i )
+    {
+        if( xml[i] != cached[i] )
+            differences.append( QString( "point %1 different" ).arg( i ) );
+        else if( xml.getArcLength( i ) != cached.getArcLength( i ) )
+            differences.append( QString( "arc length of point %1 different" ).arg( i ) );
+        else if( xml.findPointAfter( xml[i].y ) != cached.findPointAfter( xml[i].y ) )
+            differences.append( QString( "point after the y of point %1 different" ).arg( i ) );
+        else
+        {
+            int xmlSegment = -1;
+            int cachedSegment = -1;
+            xml.findClosestPoint( xml[i], &xmlSegment );
+            cached.findClosestPoint( xml[i], &cachedSegment );
+            if( xmlSegment != cachedSegment || xmlSegment < 0 )
+                differences.append( QString( "closest segment of point %1: %2 from the xml, %3 from the cache" ).arg( i ).arg( xmlSegment ).arg( cachedSegment ) );
+        }
+    }
+
+    return differences;
+}
+
+// Differences between the validation of the whole curve and the one of a ValidationSession fed one point at a time
+static QStringList compareSession( const Mannequin* mannequin, const Curve& curve, const ValidationResult& result )
+{
+    QStringList differences;
+    ValidationSession session( mannequin );
+
+    for( int i=0; i<curve.size(); ++i )
+    {
+        PointValidity::Status verdict = session.pushPoint( curve[i] );
+        if( verdict != result.getVerdict( i ) && differences.size() < MaxDifferencesShown )
+            differences.append( QString( "point %1 %2 in the session, %3 in the whole curve" ).arg( i ).arg( PointValidity::name( verdict ) )
+                                                                                            .arg( PointValidity::name( result.getVerdict( i ) ) ) );
+    }
+
+    if( session.currentStatus() != result.getStatus() )
+        differences.append( QString( "status %1 in the session, %2 in the whole curve" ).arg( CurveValidity::name( session.currentStatus() ) )
+                                                                                       .arg( CurveValidity::name( result.getStatus() ) ) );
+
+    if( session.getValidPointsCount() != result.getValidPointsCount() || session.getInvalidPointsCount() != result.getInvalidPointsCount()
+        || session.getIgnoredPointsCount() != result.getIgnoredPointsCount() )
+        differences.append( QString( "%1 valid, %2 invalid and %3 ignored points in the session, %4, %5 and %6 in the whole curve" )
+                            .arg( session.getValidPointsCount() ).arg( session.getInvalidPointsCount() ).arg( session.getIgnoredPointsCount() )
+                            .arg( result.getValidPointsCount() ).arg( result.getInvalidPointsCount() ).arg( result.getIgnoredPointsCount() ) );
+
+    return differences;
+}
+
+// 95th percentile of the validation time of curve, in microseconds
+static double validationTimeP95( const Mannequin* mannequin, const Curve& curve, ValidationResult& result, int runs )
+{
+    QVector<qint64> times( runs );
+
+    for( int i=0; i<runs; ++i )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        CurveComparer::isCurveValid( mannequin, curve, result );
+        times[i] = timer.nsecsElapsed();
+    }
+
+    std::sort( times.begin(), times.end() );
+    int p95 = qMax( ( runs * 95 + 99 ) / 100 - 1, 0 );
+
+    return times[p95] / 1000.0;
+}
+
+// Differences with the golden file, empty if there is none
+static QStringList compare( const ValidationResult& result, const Golden& golden )
+{
+    QStringList differences;
+
+    if( result.getStatus() != golden.status )
+        differences.append( QString( "status %1, expected %2" ).arg( CurveValidity::name( result.getStatus() ) ).arg( CurveValidity::name( golden.status ) ) );
+
+    if( result.size() != golden.verdicts.size() )
+        differences.append( QString( "%1 points, expected %2" ).arg( result.size() ).arg( golden.verdicts.size() ) );
+
+    int count = qMin( result.size(), golden.verdicts.size() );
+    int different = 0;
+    for( int i=0; i<count; ++i )
+    {
+        if( result.getVerdict( i ) == golden.verdicts[i] )
+            continue;
+
+        if( different < MaxDifferencesShown )
+            differences.append( QString( "point %1 %2, expected %3" ).arg( i ).arg( PointValidity::name( result.getVerdict( i ) ) )
+                                                                     .arg( PointValidity::name( golden.verdicts[i] ) ) );
+        different++;
+    }
+    if( different > MaxDifferencesShown )
+        differences.append( QString( "... %1 points different in all" ).arg( different ) );
+
+    return differences;
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+
+    // the warnings of the validations would be repeated at each run
+    Log::setLevel( Log::Error );
+
+    QStringList arguments = app.arguments();
+    QString fixturesDirectory = ".";
+    QString mannequinFilename;
+    int runs = 200;
+    double budgetScale = 1.0;
+    bool update = false;
+
+    for( int i=1; i<arguments.size(); ++i )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-d" && hasValue )
+            fixturesDirectory = arguments[++i];
+        else if( arg == "-m" && hasValue )
+            mannequinFilename = arguments[++i];
+        else if( arg == "-r" && hasValue )
+            runs = arguments[++i].toInt();
+        else if( arg == "-s" && hasValue )
+            budgetScale = arguments[++i].toDouble();
+        else if( arg == "-u" )
+            update = true;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    if( runs < 1 || budgetScale <= 0.0 )
+    {
+        usage();
+        return 2;
+    }
+
+    QDir fixtures( fixturesDirectory );
+    if( mannequinFilename.isEmpty() )
+        mannequinFilename = fixtures.filePath( "bob2.mannequin" );
+
+    // a copy without its cache, so the first load reads the xml whatever is next to the original
+    QString copyFilename = QDir::temp().filePath( QString( "EsoRegression-%1.mannequin" ).arg( QCoreApplication::applicationPid() ) );
+    QString cacheFilename = Mannequin::cacheFilename( copyFilename );
+    QFile::remove( copyFilename );
+    QFile::remove( cacheFilename );
+    if( !QFile::copy( mannequinFilename, copyFilename ) )
+    {
+        fprintf( stderr, "Can't copy %s to %s.\n", qPrintable( mannequinFilename ), qPrintable( copyFilename ) );
+        return 1;
+    }
+
+    Mannequin mannequin( copyFilename );
+    bool cacheWritten = QFile::exists( cacheFilename );
+    Mannequin cachedMannequin( copyFilename );
+
+    QFile::remove( copyFilename );
+    QFile::remove( cacheFilename );
+
+    if( mannequin.size() < 2 )
+    {
+        fprintf( stderr, "Can't load %s.\n", qPrintable( mannequinFilename ) );
+        return 1;
+    }
+
+    // without the cache compiled in, both loads read the xml
+    QStringList loadDifferences;
+#ifndef ESO_NO_MANNEQUIN_CACHE
+    if( !cacheWritten )
+        loadDifferences.append( QString( "%1 not written" ).arg( cacheFilename ) );
+#else
+    Q_UNUSED( cacheWritten );
+#endif
+    if( loadDifferences.isEmpty() )
+        loadDifferences = compare( mannequin, cachedMannequin );
+
+    fprintf( stdout, "%s %-16s xml and cache loads of %s\n", loadDifferences.isEmpty() ? "PASS" : "FAIL", "mannequin",
+             qPrintable( QFileInfo( mannequinFilename ).fileName() ) );
+    for( int i=0; i<loadDifferences.size(); ++i )
+        fprintf( stdout, "     %s\n", qPrintable( loadDifferences[i] ) );
+
+    int failed = 0;
+
+    int fixturesCount = sizeof( Fixtures ) / sizeof( Fixtures[0] );
+    ValidationResult result;
+
+    for( int f=0; f<fixturesCount; ++f )
+    {
+        QString filename = fixtures.filePath( Fixtures[f] );
+        QString golden = goldenFilename( filename );
+        Curve curve;
+
+        if( !ProbeCurveLoader::load( filename, curve ) )
+        {
+            fprintf( stdout, "FAIL %-16s can't load the fixture\n", Fixtures[f] );
+            failed++;
+            continue;
+        }
+
+        CurveComparer::isCurveValid( &mannequin, curve, result );
+
+        Golden expected;
+        bool hasGolden = readGolden( golden, expected );
+
+        if( update )
+        {
+            double budget = hasGolden ? expected.budgetUsecs : DefaultBudgetUsecs;
+            if( !writeGolden( golden, Fixtures[f], QFileInfo( mannequinFilename ).fileName(), result, budget ) )
+            {
+                fprintf( stdout, "FAIL %-16s can't write %s\n", Fixtures[f], qPrintable( golden ) );
+                failed++;
+            }
+            else
+                fprintf( stdout, "WROTE %-15s %s, %d points\n", Fixtures[f], CurveValidity::name( result.getStatus() ), result.size() );
+            continue;
+        }
+
+        if( !hasGolden )
+        {
+            fprintf( stdout, "FAIL %-16s can't read %s\n", Fixtures[f], qPrintable( golden ) );
+            failed++;
+            continue;
+        }
+
+        QStringList differences = compare( result, expected );
+
+        // the same golden file for the load from the cache
+        ValidationResult cachedResult;
+        CurveComparer::isCurveValid( &cachedMannequin, curve, cachedResult );
+        QStringList cachedDifferences = compare( cachedResult, expected );
+        for( int i=0; i<cachedDifferences.size(); ++i )
+            differences.append( "from the cache: " + cachedDifferences[i] );
+
+        differences += compareSession( &mannequin, curve, result );
+
+        double p95 = validationTimeP95( &mannequin, curve, result, runs );
+        double budget = expected.budgetUsecs * budgetScale;
+        if( p95 > budget )
+            differences.append( QString( "p95 %1 us over the budget of %2 us" ).arg( p95, 0, 'f', 1 ).arg( budget, 0, 'f', 1 ) );
+
+        fprintf( stdout, "%s %-16s %-20s %4d points  p95 %8.1f us  (budget %.1f us)\n", differences.isEmpty() ? "PASS" : "FAIL",
+                 Fixtures[f], CurveValidity::name( result.getStatus() ), result.size(), p95, budget );
+        for( int i=0; i<differences.size(); ++i )
+            fprintf( stdout, "     %s\n", qPrintable( differences[i] ) );
+
+        if( !differences.isEmpty() )
+            failed++;
+    }
+
+    fprintf( stdout, "%d/%d fixtures passed\n", fixturesCount - failed, fixturesCount );
+    return failed > 0 || !loadDifferences.isEmpty() ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <cstdio>
+
+#include "Log.h"
+#include "Mannequin.h"
+#include "Sleeper.h"
+#include "TrackerPipeline.h"
+
+// Validate the points of a tracker live, as they arrive, and report the metrics of the pipeline every second.
+//
+//  EsoTracker -m bob2.mannequin (-u port | -r file.csv [-z rate] [-s speed] [-L]) [-e SameHeight|ClosestPoint]
+//             [-c ringCapacity] [-d seconds] [-v] [-l level]
+//
+// -u listens to the udp datagrams of the tracker on the local port, -r replays a csv file instead at rate points
+// per second (240 by default), speed times faster than real time (0 = as fast as possible), looped with -L.
+// It runs until the replay is done, or for -d seconds (forever by default with -u or -L).
+// The metrics go to stderr every second, the last ones to stdout.
+
+static void usage()
+{
+    fprintf( stderr, "usage: EsoTracker -m file.mannequin (-u port | -r file.csv [-z rate] [-s speed] [-L]) [-e SameHeight|ClosestPoint] [-c ringCapacity] [-d seconds] [-v] [-l trace|debug|info|warning|error|off]\n" );
+}
+
+static void printMetrics( FILE* output, const TrackerMetrics& metrics, double seconds )
+{
+    const LatencyHistogram& latency = metrics.latency;
+
+    fprintf( output, "%8.1f s  %s  received %lld  dropped %lld  validated %lld  ring %d/%d (max %d)  latency p50 %.3f ms  p99 %.3f ms  max %.3f ms\n",
+             seconds, CurveValidity::name( metrics.status ), metrics.receivedCount, metrics.droppedCount, metrics.validatedCount,
+             metrics.ringOccupancy, metrics.ringCapacity, metrics.maxRingOccupancy,
+             latency.percentile( 0.5 ) / 1e6, latency.percentile( 0.99 ) / 1e6, latency.getMax() / 1e6 );
+}
+
+int main( int argc, char *argv[] )
+{
+    QCoreApplication app( argc, argv );
+    Log::setLevel( Log::Warning );
+
+    QStringList arguments = app.arguments();
+    QString mannequinFile;
+    QString replayFile;
+    int port = -1;
+    double rate = 240.0;
+    double speed = 1.0;
+    bool loop = false;
+    int ringCapacity = 4096;
+    double duration = 0.0;
+    Matching::Method matching = Matching::SameHeight;
+
+    for( int i = 1; i < arguments.size(); i++ )
+    {
+        const QString& arg = arguments[i];
+        bool hasValue = i + 1 < arguments.size();
+
+        if( arg == "-m" && hasValue )
+            mannequinFile = arguments[++i];
+        else if( arg == "-u" && hasValue )
+            port = arguments[++i].toInt();
+        else if( arg == "-r" && hasValue )
+            replayFile = arguments[++i];
+        else if( arg == "-z" && hasValue )
+            rate = arguments[++i].toDouble();
+        else if( arg == "-s" && hasValue )
+            speed = arguments[++i].toDouble();
+        else if( arg == "-L" )
+            loop = true;
+        else if( arg == "-c" && hasValue )
+            ringCapacity = arguments[++i].toInt();
+        else if( arg == "-d" && hasValue )
+            duration = arguments[++i].toDouble();
+        else if( arg == "-e" && hasValue )
+        {
+            if( !Matching::fromName( arguments[++i], matching ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else if( arg == "-v" )
+            Log::setLevel( Log::Debug );
+        else if( arg == "-l" && hasValue )
+        {
+            if( !Log::setLevel( arguments[++i] ) )
+            {
+                usage();
+                return 2;
+            }
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    // one source, and a rate for the replay
+    if( mannequinFile.isEmpty() || ( port < 0 ) == replayFile.isEmpty() || port > 65535 || rate <= 0.0 )
+    {
+        usage();
+        return 2;
+    }
+
+    Mannequin mannequin( mannequinFile );
+    mannequin.setMatching( matching );
+
+    TrackerSource* source;
+    if( port >= 0 )
+        source = new UdpTrackerSource( quint16( port ) );
+    else
+        source = new CsvReplaySource( replayFile, rate, speed, loop );
+
+    fprintf( stderr, "Validating %s against %s\n", qPrintable( source->description() ), qPrintable( mannequin.getName() ) );
+
+    TrackerPipeline pipeline( source, &mannequin, ringCapacity );
+    QElapsedTimer timer;
+    timer.start();
+    pipeline.start();
+
+    qint64 nextReport = 1000;
+    while( !pipeline.isFinished() )
+    {
+        if( duration > 0.0 && timer.elapsed() >= duration * 1000 )
+            pipeline.stop();
+
+        if( timer.elapsed() >= nextReport )
+        {
+            printMetrics( stderr, pipeline.getMetrics(), timer.elapsed() / 1000.0 );
+            nextReport += 1000;
+        }
+
+        Sleeper::msleep( 10 );
+    }
+
+    TrackerMetrics metrics = pipeline.getMetrics();
+    printMetrics( stdout, metrics, timer.elapsed() / 1000.0 );
+
+    return metrics.receivedCount > 0 ? 0 : 1;
+}